@@ -0,0 +1,78 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+struct process;
+struct list_head;
+struct sim;
+
+/***********************************************************************
+ * struct cpu
+ *
+ * DESCRIPTION
+ *   A simulated processor. Each CPU runs its own @current process, and
+ *   keeps the processes ready to run on it in its own runqueue. Scheduler
+ *   callbacks are given the CPU to make the decision for.
+ */
+struct cpu {
+	unsigned int id;
+	struct sim *sim;	/* The simulation this CPU belongs to */
+
+	/**
+	 * The process that is currently running on this CPU
+	 */
+	struct process *current;
+
+	/**
+	 * List head to hold the processes ready to run on this CPU. Newly forked
+	 * processes are put here by the framework
+	 */
+	struct list_head readyqueue;
+
+	/**
+	 * Runqueues for the schedulers that do not keep the ready processes in
+	 * @readyqueue. Each scheduler uses one of them
+	 */
+	struct prio_array prio_array;
+	struct heap heap;
+	unsigned long long heap_seq;	/* Enqueueing order on @heap */
+	long long epoch;		/* Aging epoch of the priority + aging scheduler, or
+					   boost epoch of the multi-level feedback queue */
+	long long min_vruntime;		/* Floor of the virtual runtimes on the fair scheduler */
+
+	/**
+	 * Proportional-share bookkeeping. @global_pass grows by the pass of a
+	 * ticket when all of @nr_tickets are served a tick
+	 */
+	long long global_pass;
+	unsigned int global_pass_at;	/* Tick @global_pass was brought up to */
+	unsigned long long nr_tickets;	/* Tickets of the runnable processes on this CPU */
+	unsigned long long lottery_seed;	/* Random state of the lottery scheduler */
+
+	/** DO NOT ACCESS FOLLOWING VARIABLES **/
+	struct process *__blocked;	/* The process blocked on this CPU in the last tick */
+	struct process *__ran;		/* The process made a progress in the last tick */
+
+	unsigned int __nr_ran;		/* # of ticks a process made a progress */
+	unsigned int __nr_stolen;	/* # of processes stolen while being idle */
+	unsigned int __nr_migrated_in;	/* # of processes migrated from other CPUs */
+	unsigned int __nr_migrated_out;	/* # of processes migrated to other CPUs */
+};
+
+#define MAX_NR_CPUS	256
+
+#endif
@@ -0,0 +1,153 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "types.h"
+
+#include "event_log.h"
+
+struct event_log *event_log_create(FILE *file, unsigned int nr_cpus)
+{
+	struct event_log *log = malloc(sizeof(*log));
+	struct event_log_header header = {
+		.version = EVENT_LOG_VERSION,
+		.nr_cpus = nr_cpus,
+	};
+
+	assert(log);
+	log->file = file;
+	log->nr_events = 0;
+
+	memcpy(header.magic, EVENT_LOG_MAGIC, EVENT_LOG_MAGIC_LEN);
+	fwrite(&header, sizeof(header), 1, file);
+
+	return log;
+}
+
+void event_log_destroy(struct event_log *log)
+{
+	event_log_flush(log);
+	fflush(log->file);
+	free(log);
+}
+
+void event_log_flush(struct event_log *log)
+{
+	fwrite(log->events, sizeof(*log->events), log->nr_events, log->file);
+	log->nr_events = 0;
+}
+
+int event_log_read_header(FILE *file, unsigned int *nr_cpus)
+{
+	struct event_log_header header;
+
+	if (fread(&header, sizeof(header), 1, file) != 1) return -1;
+	if (memcmp(header.magic, EVENT_LOG_MAGIC, EVENT_LOG_MAGIC_LEN)) return -1;
+	if (header.version != EVENT_LOG_VERSION) return -1;
+
+	*nr_cpus = header.nr_cpus;
+	return 0;
+}
+
+/* Width of the column of a CPU in the text log */
+#define CPU_COLUMN_WIDTH	12
+
+void event_print(FILE *out, const struct event *event, unsigned int nr_cpus)
+{
+	fprintf(out, "%3d: ", event->tick);
+
+	/* Indent by the pid, or by the CPU with many, in a single call */
+	if (nr_cpus > 1) {
+		fprintf(out, "%*s", event->cpu * CPU_COLUMN_WIDTH, "");
+		if (event->type != EVENT_RUN && event->type != EVENT_IDLE) {
+			fprintf(out, "%u ", event->pid);
+		}
+	} else {
+		fprintf(out, "%*s", event->pid * 4, "");
+	}
+
+	switch (event->type) {
+	case EVENT_FORK:
+		fprintf(out, "N\n");
+		break;
+	case EVENT_EXIT:
+		fprintf(out, "X\n");
+		break;
+	case EVENT_RUN:
+		fprintf(out, "%d\n", event->pid);
+		break;
+	case EVENT_BLOCK:
+		fprintf(out, "=\n");
+		break;
+	case EVENT_ACQUIRE:
+		fprintf(out, "+%u\n", event->arg);
+		break;
+	case EVENT_RELEASE:
+		fprintf(out, "-%u\n", event->arg);
+		break;
+	case EVENT_MIGRATE:
+		fprintf(out, "M%u\n", event->arg);
+		break;
+	case EVENT_IDLE:
+		fprintf(out, "idle\n");
+		break;
+	case EVENT_KILL:
+		fprintf(out, "K\n");
+		break;
+	default:
+		fprintf(out, "?%u\n", event->type);
+		break;
+	}
+}
+
+void event_print_span(FILE *out, const struct event *spans, unsigned int nr_cpus)
+{
+	for (uint32_t i = 0; i < spans->arg; i++) {
+		for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+			struct event event = {
+				.tick = spans[cpu].tick + i,
+				.pid = spans[cpu].pid,
+				.type = spans[cpu].type == EVENT_RUN_SPAN ? EVENT_RUN : EVENT_IDLE,
+				.cpu = spans[cpu].cpu,
+			};
+
+			event_print(out, &event, nr_cpus);
+		}
+	}
+}
+
+size_t event_print_events(FILE *out, const struct event *events, size_t nr_events,
+		unsigned int nr_cpus)
+{
+	size_t i = 0;
+
+	while (i < nr_events) {
+		if (events[i].type != EVENT_RUN_SPAN && events[i].type != EVENT_IDLE_SPAN) {
+			event_print(out, events + i++, nr_cpus);
+			continue;
+		}
+		if (nr_events - i < nr_cpus) break;
+
+		event_print_span(out, events + i, nr_cpus);
+		i += nr_cpus;
+	}
+	return i;
+}
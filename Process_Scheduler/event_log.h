@@ -0,0 +1,172 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __EVENT_LOG_H__
+#define __EVENT_LOG_H__
+
+/**
+ * Events in the simulation. Each is logged with the tick, the CPU, and the
+ * process it happens to, and is rendered in the text log as commented
+ */
+enum event_type {
+	EVENT_FORK,		/* N */
+	EVENT_EXIT,		/* X */
+	EVENT_RUN,		/* pid */
+	EVENT_BLOCK,		/* = */
+	EVENT_ACQUIRE,		/* +resource */
+	EVENT_RELEASE,		/* -resource */
+	EVENT_MIGRATE,		/* Msource CPU */
+	EVENT_IDLE,		/* idle */
+	EVENT_KILL,		/* K */
+	EVENT_RUN_SPAN,		/* EVENT_RUN for @arg ticks */
+	EVENT_IDLE_SPAN,	/* EVENT_IDLE for @arg ticks */
+};
+
+struct event {
+	uint32_t tick;
+	uint32_t pid;		/* 0 for EVENT_IDLE */
+	uint32_t arg;		/* Resource for EVENT_ACQUIRE/RELEASE, CPU for EVENT_MIGRATE,
+				   # of ticks for the spans */
+	uint8_t type;		/* enum event_type */
+	uint8_t cpu;
+	uint16_t __reserved;
+};
+
+/**
+ * A binary event log file starts with this header followed by the events
+ * in struct event, in the byte order of the host that wrote it. The ticks
+ * skipped by the event-driven simulation are logged as a span for each
+ * CPU in a row, rather than tick by tick
+ */
+#define EVENT_LOG_MAGIC		"SCHEDEVT"
+#define EVENT_LOG_MAGIC_LEN	8
+#define EVENT_LOG_VERSION	1
+
+struct event_log_header {
+	char magic[EVENT_LOG_MAGIC_LEN];
+	uint32_t version;
+	uint32_t nr_cpus;
+};
+
+#define EVENT_LOG_BUFFER	65536	/* # of events to buffer before writing */
+
+/***********************************************************************
+ * struct event_log
+ *
+ * DESCRIPTION
+ *   Binary event log being written. Events are collected in @events and
+ *   written to @file EVENT_LOG_BUFFER events at a time.
+ */
+struct event_log {
+	FILE *file;
+	unsigned int nr_events;
+	struct event events[EVENT_LOG_BUFFER];
+};
+
+
+/***********************************************************************
+ * event_log_create()
+ *
+ * DESCRIPTION
+ *   Start a binary event log of a simulation on @nr_cpus CPUs in @file
+ */
+struct event_log *event_log_create(FILE *file, unsigned int nr_cpus);
+
+
+/***********************************************************************
+ * event_log_destroy()
+ *
+ * DESCRIPTION
+ *   Write the events buffered in @log and free @log. @log->file is left
+ *   open.
+ */
+void event_log_destroy(struct event_log *log);
+
+
+/***********************************************************************
+ * event_log_flush()
+ *
+ * DESCRIPTION
+ *   Write the events buffered in @log to @log->file
+ */
+void event_log_flush(struct event_log *log);
+
+
+/***********************************************************************
+ * event_log_append()
+ *
+ * DESCRIPTION
+ *   Buffer @event to write to @log
+ */
+static inline void event_log_append(struct event_log *log, const struct event *event)
+{
+	if (log->nr_events == EVENT_LOG_BUFFER) event_log_flush(log);
+
+	log->events[log->nr_events++] = *event;
+}
+
+
+/***********************************************************************
+ * event_log_read_header()
+ *
+ * DESCRIPTION
+ *   Read the header of the binary event log in @file. The events follow
+ *   in @file.
+ *
+ * RETURN
+ *   0 with @nr_cpus set on success
+ *   -1 if @file is not a binary event log
+ */
+int event_log_read_header(FILE *file, unsigned int *nr_cpus);
+
+
+/***********************************************************************
+ * event_print()
+ *
+ * DESCRIPTION
+ *   Print @event of a simulation on @nr_cpus CPUs to @out in the text log
+ *   format. The event is indented by the pid so that the events of a
+ *   process line up in a column. With more than one CPU, it is indented
+ *   by the CPU instead, one column per CPU, and led by the pid.
+ */
+void event_print(FILE *out, const struct event *event, unsigned int nr_cpus);
+
+
+/***********************************************************************
+ * event_print_span()
+ *
+ * DESCRIPTION
+ *   Print the span of each of @nr_cpus CPUs in @spans to @out tick by
+ *   tick, as the CPUs would be logged running or idling every tick.
+ */
+void event_print_span(FILE *out, const struct event *spans, unsigned int nr_cpus);
+
+
+/***********************************************************************
+ * event_print_events()
+ *
+ * DESCRIPTION
+ *   Print @events of a simulation on @nr_cpus CPUs to @out in the text log
+ *   format, spans expanded. The spans at the end that are not complete
+ *   for all the CPUs are left to be printed with the events to follow.
+ *
+ * RETURN
+ *   # of events printed from the head of @events
+ */
+size_t event_print_events(FILE *out, const struct event *events, size_t nr_events,
+		unsigned int nr_cpus);
+
+#endif
@@ -0,0 +1,67 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+/**
+ * Render a binary event log written by sched -o in the same text format
+ * as sched logs to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "types.h"
+
+#include "event_log.h"
+
+int main(int argc, char * const argv[])
+{
+	static struct event events[EVENT_LOG_BUFFER];
+	unsigned int nr_cpus;
+	size_t nr_read, nr_left = 0;
+	FILE *file;
+
+	if (argc != 2) {
+		printf("Usage: %s [binary event log file]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	file = fopen(argv[1], "rb");
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	if (event_log_read_header(file, &nr_cpus)) {
+		fprintf(stderr, "%s is not a binary event log\n", argv[1]);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	/* The spans of the CPUs may be split across the reads */
+	while ((nr_read = fread(events + nr_left, sizeof(*events),
+			EVENT_LOG_BUFFER - nr_left, file))) {
+		size_t nr_events = nr_left + nr_read;
+		size_t nr_printed = event_print_events(stdout, events, nr_events, nr_cpus);
+
+		nr_left = nr_events - nr_printed;
+		memmove(events, events + nr_printed, nr_left * sizeof(*events));
+	}
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+
+#include "heap.h"
+
+static inline void __place(struct heap *heap, unsigned int index, struct heap_node *node)
+{
+	heap->nodes[index] = node;
+	node->index = index;
+}
+
+static void __sift_up(struct heap *heap, unsigned int index)
+{
+	struct heap_node *node = heap->nodes[index];
+
+	while (index > 1) {
+		struct heap_node *parent = heap->nodes[index / 2];
+		if (!heap->less(node, parent)) break;
+
+		__place(heap, index, parent);
+		index /= 2;
+	}
+	__place(heap, index, node);
+}
+
+static void __sift_down(struct heap *heap, unsigned int index)
+{
+	struct heap_node *node = heap->nodes[index];
+
+	while (index * 2 <= heap->nr_nodes) {
+		unsigned int child = index * 2;
+
+		if (child < heap->nr_nodes &&
+				heap->less(heap->nodes[child + 1], heap->nodes[child])) {
+			child++;
+		}
+		if (!heap->less(heap->nodes[child], node)) break;
+
+		__place(heap, index, heap->nodes[child]);
+		index = child;
+	}
+	__place(heap, index, node);
+}
+
+void heap_init(struct heap *heap, bool (*less)(struct heap_node *, struct heap_node *))
+{
+	heap->nodes = NULL;
+	heap->nr_nodes = 0;
+	heap->capacity = 0;
+	heap->less = less;
+}
+
+void heap_destroy(struct heap *heap)
+{
+	free(heap->nodes);
+	heap->nodes = NULL;
+	heap->nr_nodes = heap->capacity = 0;
+}
+
+void heap_push(struct heap *heap, struct heap_node *node)
+{
+	assert(!heap_queued(node));
+
+	/* nodes[0] is not used to keep the index arithmetic simple */
+	if (heap->nr_nodes + 1 >= heap->capacity) {
+		heap->capacity = heap->capacity ? heap->capacity * 2 : 64;
+		heap->nodes = realloc(heap->nodes, sizeof(*heap->nodes) * heap->capacity);
+		assert(heap->nodes);
+	}
+
+	heap->nodes[++heap->nr_nodes] = node;
+	__sift_up(heap, heap->nr_nodes);
+}
+
+struct heap_node *heap_pop(struct heap *heap)
+{
+	struct heap_node *top = heap_peek(heap);
+
+	if (top) heap_remove(heap, top);
+
+	return top;
+}
+
+void heap_remove(struct heap *heap, struct heap_node *node)
+{
+	unsigned int index = node->index;
+	struct heap_node *last;
+
+	assert(heap_queued(node) && heap->nodes[index] == node);
+
+	last = heap->nodes[heap->nr_nodes--];
+	node->index = 0;
+
+	if (last == node) return;
+
+	__place(heap, index, last);
+	heap_update(heap, last);
+}
+
+void heap_update(struct heap *heap, struct heap_node *node)
+{
+	unsigned int index = node->index;
+
+	assert(heap_queued(node));
+
+	if (index > 1 && heap->less(node, heap->nodes[index / 2])) {
+		__sift_up(heap, index);
+	} else {
+		__sift_down(heap, index);
+	}
+}
+
+struct heap_node *heap_peek_last(struct heap *heap)
+{
+	struct heap_node *last;
+
+	if (!heap->nr_nodes) return NULL;
+
+	/* Every inner node comes out before its children, so scan the leaves */
+	last = heap->nodes[heap->nr_nodes];
+	for (unsigned int i = heap->nr_nodes / 2 + 1; i < heap->nr_nodes; i++) {
+		if (heap->less(last, heap->nodes[i])) last = heap->nodes[i];
+	}
+	return last;
+}
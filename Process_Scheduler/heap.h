@@ -0,0 +1,136 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+/***********************************************************************
+ * struct heap_node
+ *
+ * DESCRIPTION
+ *   Embed this into the structure to put into a heap, and get back to the
+ *   structure with container_of(). @index is the 1-based position of the
+ *   node in the heap, and 0 means the node is not in any heap. Thus,
+ *   a zero-filled node is ready to use.
+ */
+struct heap_node {
+	unsigned int index;
+};
+
+
+/***********************************************************************
+ * struct heap
+ *
+ * DESCRIPTION
+ *   Binary min-heap of heap_nodes ordered by @less. The node for which
+ *   @less() holds against all the others is on the top.
+ */
+struct heap {
+	struct heap_node **nodes;
+	unsigned int nr_nodes;
+	unsigned int capacity;
+	bool (*less)(struct heap_node *a, struct heap_node *b);
+};
+
+
+/***********************************************************************
+ * heap_init()
+ *
+ * DESCRIPTION
+ *   Initialize @heap to be empty and to be ordered by @less
+ */
+void heap_init(struct heap *heap, bool (*less)(struct heap_node *, struct heap_node *));
+
+
+/***********************************************************************
+ * heap_destroy()
+ *
+ * DESCRIPTION
+ *   Release the memory held by @heap. The nodes are left untouched.
+ */
+void heap_destroy(struct heap *heap);
+
+
+/***********************************************************************
+ * heap_push()
+ *
+ * DESCRIPTION
+ *   Put @node into @heap in O(log n)
+ */
+void heap_push(struct heap *heap, struct heap_node *node);
+
+
+/***********************************************************************
+ * heap_pop()
+ *
+ * DESCRIPTION
+ *   Take the top node out of @heap in O(log n)
+ *
+ * RETURN
+ *   The top node, NULL if @heap is empty
+ */
+struct heap_node *heap_pop(struct heap *heap);
+
+
+/***********************************************************************
+ * heap_remove()
+ *
+ * DESCRIPTION
+ *   Take @node out of @heap in O(log n). @node may be at any position.
+ */
+void heap_remove(struct heap *heap, struct heap_node *node);
+
+
+/***********************************************************************
+ * heap_update()
+ *
+ * DESCRIPTION
+ *   Restore the heap order after the key of @node has been changed
+ */
+void heap_update(struct heap *heap, struct heap_node *node);
+
+
+/***********************************************************************
+ * heap_peek_last()
+ *
+ * DESCRIPTION
+ *   Find the node that would come out of @heap last in O(n) over the
+ *   leaves. The node is left in @heap
+ *
+ * RETURN
+ *   The last node, NULL if @heap is empty
+ */
+struct heap_node *heap_peek_last(struct heap *heap);
+
+
+static inline struct heap_node *heap_peek(struct heap *heap)
+{
+	return heap->nr_nodes ? heap->nodes[1] : NULL;
+}
+
+static inline bool heap_empty(struct heap *heap)
+{
+	return heap->nr_nodes == 0;
+}
+
+static inline bool heap_queued(struct heap_node *node)
+{
+	return node->index != 0;
+}
+
+#define heap_entry(ptr, type, member) \
+	((ptr) ? container_of(ptr, type, member) : NULL)
+
+#endif
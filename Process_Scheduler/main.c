@@ -0,0 +1,349 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/*====================================================================*/
+/*          ******        DO NOT MODIFY THIS FILE        ******       */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "resource.h"
+#include "prio_array.h"
+#include "cpu.h"
+#include "sim.h"
+#include "metrics.h"
+
+#include "sched.h"
+
+/**
+ * Assorted schedulers
+ */
+extern struct scheduler fifo_scheduler;
+extern struct scheduler sjf_scheduler;
+extern struct scheduler srtf_scheduler;
+extern struct scheduler rr_scheduler;
+extern struct scheduler prio_scheduler;
+extern struct scheduler pa_scheduler;
+extern struct scheduler pcp_scheduler;
+extern struct scheduler pip_scheduler;
+extern struct scheduler fair_scheduler;
+extern struct scheduler mlfq_scheduler;
+extern struct scheduler edf_scheduler;
+extern struct scheduler stride_scheduler;
+extern struct scheduler lottery_scheduler;
+
+static void __print_banner(struct sim *sim)
+{
+	if (sim->quiet) return;
+	printf("               _              _ \n");
+	printf("              | |            | |\n");
+	printf("      ___  ___| |__   ___  __| |\n");
+	printf("     / __|/ __| '_ \\ / _ \\/ _` |\n");
+	printf("     \\__ \\ (__| | | |  __/ (_| |\n");
+	printf("     |___/\\___|_| |_|\\___|\\__,_|\n");
+	printf("\n");
+	printf("                                 2021 Fall\n");
+	printf("      Simulating %s scheduler\n", sim->sched->name);
+	if (sim->nr_cpus > 1) {
+		printf("      on %u CPUs\n", sim->nr_cpus);
+	}
+	printf("\n");
+	printf("****************************************************\n");
+	printf("   N: Forked\n");
+	printf("   X: Finished\n");
+	printf("   =: Blocked\n");
+	printf("  +n: Acquire resource n\n");
+	printf("  -n: Release resource n\n");
+	if (sim->balance != BALANCE_NONE) {
+		printf("  Mn: Migrated from CPU n\n");
+	}
+	if (sim->deadlock == DEADLOCK_KILL) {
+		printf("   K: Killed to break a deadlock\n");
+	}
+	if (sim->nr_cpus > 1) {
+		printf("  One column per CPU, with the pid ahead of each event\n");
+	}
+	printf("\n");
+}
+
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-q} {-e} {-l} {-m} {-M} {-o file} {-n cpus} {-N resources} {-D abort|kill|ignore} {-W writers|readers} {-b pull|push} {-B ticks} {-Q ticks} {-g ticks} {-w ticks} {-T quanta} {-R ticks} -[f|s|S|r|a|p|i|F|L|d|x|y] [process script file]\n", name);
+	printf("\n");
+	printf("  -q: Run quietly\n");
+	printf("  -e: Skip the ticks without events (event-driven simulation)\n");
+	printf("  -l: Stream the script sorted by the forking time in bounded memory\n");
+	printf("  -m: Report the allocations of processes and resource schedules\n");
+	printf("  -M: Report the percentiles of turnaround, waiting, and response times,\n");
+	printf("      and the shares of the CPU with the Stride and Lottery schedulers\n");
+	printf("  -o: Write the events to @file in the binary format rather than to stderr\n");
+	printf("  -n: Simulate @cpus processors (1 by default, up to %d)\n", MAX_NR_CPUS);
+	printf("  -N: Simulate @resources resources (%d by default, up to %d)\n", NR_RESOURCES, MAX_NR_RESOURCES);
+	printf("  -D: On a deadlock, [abort] the simulation (default), [kill] the process closing\n");
+	printf("      the cycle, or [ignore] it to leave the processes waiting forever\n");
+	printf("  -W: Let the [writers] (default) or the [readers] go first on shared resources\n");
+	printf("  -b: Balance the load across the CPUs by [pull|push]ing processes\n");
+	printf("  -B: Balance the load every @ticks ticks (10 by default)\n");
+	printf("  -Q: Time quantum of the round-robin scheduler (1 by default)\n");
+	printf("  -g: Minimum granularity of the fair scheduler (1 by default)\n");
+	printf("  -w: Sleeper credit of the fair scheduler in ticks (3 by default)\n");
+	printf("  -T: Comma-separated time quanta of the MLFQ levels from the top (1,2,4 by default)\n");
+	printf("  -R: Boost every process to the top MLFQ level every @ticks ticks (50 by default, 0 not to)\n\n");
+	printf("  -f: Use FIFO scheduler (default)\n");
+	printf("  -s: Use SJF scheduler\n");
+	printf("  -S: Use SRTF scheduler\n");
+	printf("  -r: Use Round-robin scheduler\n");
+	printf("  -p: Use Priority scheduler\n");
+	printf("  -a: Use Priority scheduler with aging\n");
+	printf("  -c: Use Priority scheduler with PCP\n");
+	printf("  -i: Use Priority scheduler with PIP\n");
+	printf("  -F: Use Completely Fair scheduler\n");
+	printf("  -L: Use Multi-Level Feedback Queue scheduler\n");
+	printf("  -d: Use Earliest Deadline First scheduler\n");
+	printf("  -x: Use Stride scheduler\n");
+	printf("  -y: Use Lottery scheduler\n");
+	printf("\n");
+}
+
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	char *scriptfile;
+	char *eventfile = NULL;
+	struct sim sim;
+	int ret;
+
+	sim_init(&sim, &fifo_scheduler);
+
+	while ((opt = getopt(argc, argv, "qelmMo:n:N:D:W:b:B:Q:g:w:T:R:fsSrpaicFLdxyh")) != -1) {
+		switch (opt) {
+		case 'q':
+			sim.quiet = true;
+			break;
+		case 'e':
+			sim.event_driven = true;
+			break;
+		case 'l':
+			sim.streaming = true;
+			break;
+		case 'm':
+			sim.report_pools = true;
+			break;
+		case 'M':
+			sim.collect_metrics = true;
+			break;
+		case 'o':
+			eventfile = optarg;
+			break;
+		case 'n':
+			if (atoi(optarg) < 1 || atoi(optarg) > MAX_NR_CPUS) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.nr_cpus = atoi(optarg);
+			break;
+		case 'N':
+			if (atoi(optarg) < 1 || atoi(optarg) > MAX_NR_RESOURCES) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.nr_resources = atoi(optarg);
+			break;
+		case 'D':
+			if (strcmp(optarg, "abort") == 0) {
+				sim.deadlock = DEADLOCK_ABORT;
+			} else if (strcmp(optarg, "kill") == 0) {
+				sim.deadlock = DEADLOCK_KILL;
+			} else if (strcmp(optarg, "ignore") == 0) {
+				sim.deadlock = DEADLOCK_IGNORE;
+			} else {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'W':
+			if (strcmp(optarg, "writers") == 0) {
+				sim.rw_preference = RW_PREFER_WRITERS;
+			} else if (strcmp(optarg, "readers") == 0) {
+				sim.rw_preference = RW_PREFER_READERS;
+			} else {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'b':
+			if (strcmp(optarg, "pull") == 0) {
+				sim.balance = BALANCE_PULL;
+			} else if (strcmp(optarg, "push") == 0) {
+				sim.balance = BALANCE_PUSH;
+			} else {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'B':
+			if (atoi(optarg) < 1) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.balance_interval = atoi(optarg);
+			break;
+		case 'Q':
+			if (atoi(optarg) < 1) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.quantum = atoi(optarg);
+			break;
+		case 'g':
+			if (atoi(optarg) < 1) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.min_granularity = atoi(optarg);
+			break;
+		case 'w':
+			if (atoi(optarg) < 0) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.sleeper_credit = atoi(optarg);
+			break;
+		case 'T': {
+			char *token = strtok(optarg, ",");
+			sim.mlfq_levels = 0;
+			while (token) {
+				if (atoi(token) < 1 || sim.mlfq_levels == MAX_MLFQ_LEVELS) {
+					__print_usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				sim.mlfq_quanta[sim.mlfq_levels++] = atoi(token);
+				token = strtok(NULL, ",");
+			}
+			if (sim.mlfq_levels == 0) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		}
+		case 'R':
+			if (atoi(optarg) < 0) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			sim.mlfq_boost = atoi(optarg);
+			break;
+
+		case 'f':
+			sim.sched = &fifo_scheduler;
+			break;
+		case 's':
+			sim.sched = &sjf_scheduler;
+			break;
+		case 'S':
+			sim.sched = &srtf_scheduler;
+			break;
+		case 'r':
+			sim.sched = &rr_scheduler;
+			break;
+		case 'p':
+			sim.sched = &prio_scheduler;
+			break;
+		case 'a':
+			sim.sched = &pa_scheduler;
+			break;
+		case 'i':
+			sim.sched = &pip_scheduler;
+			break;
+		case 'c':
+			sim.sched = &pcp_scheduler;
+			break;
+		case 'F':
+			sim.sched = &fair_scheduler;
+			break;
+		case 'L':
+			sim.sched = &mlfq_scheduler;
+			break;
+		case 'd':
+			sim.sched = &edf_scheduler;
+			break;
+		case 'x':
+			sim.sched = &stride_scheduler;
+			break;
+		case 'y':
+			sim.sched = &lottery_scheduler;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	scriptfile = argv[optind];
+
+	if (sim.balance != BALANCE_NONE &&
+			!(sim.sched->nr_ready && sim.sched->steal && sim.sched->enqueue)) {
+		fprintf(stderr, "%s scheduler does not support load balancing\n", sim.sched->name);
+		return EXIT_FAILURE;
+	}
+
+	if (eventfile) {
+		sim.events = fopen(eventfile, "wb");
+		if (!sim.events) {
+			fprintf(stderr, "Cannot open %s\n", eventfile);
+			return EXIT_FAILURE;
+		}
+		sim.log = NULL;
+	}
+
+	__print_banner(&sim);
+
+	if (sim_load_script(&sim, scriptfile)) {
+		sim_destroy(&sim);
+		if (sim.events) fclose(sim.events);
+		return EXIT_FAILURE;
+	}
+
+	ret = sim_run(&sim);
+	if (!ret && sim.metrics) {
+		metrics_report(stdout, sim.metrics);
+	}
+	sim_destroy(&sim);
+
+	if (sim.events && fclose(sim.events)) {
+		fprintf(stderr, "Cannot write %s\n", eventfile);
+		ret = -1;
+	}
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+/*          ******        DO NOT MODIFY THIS FILE        ******       */
+/*====================================================================*/
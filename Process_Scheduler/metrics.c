@@ -0,0 +1,174 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+
+#include "metrics.h"
+
+static const char * __metric_sz[] = {
+	"Turnaround",
+	"Waiting",
+	"Response",
+	"Blocked",
+	"Preemptions",
+};
+
+struct metrics *metrics_create(void)
+{
+	struct metrics *metrics = malloc(sizeof(*metrics));
+
+	assert(metrics);
+	metrics->nr_records = 0;
+	metrics->max_records = 0;
+	metrics->records = NULL;
+
+	return metrics;
+}
+
+void metrics_destroy(struct metrics *metrics)
+{
+	free(metrics->records);
+	free(metrics);
+}
+
+void metrics_add(struct metrics *metrics, const struct metrics_record *record)
+{
+	if (metrics->nr_records == metrics->max_records) {
+		metrics->max_records = metrics->max_records ? metrics->max_records * 2 : 1024;
+		metrics->records = realloc(metrics->records,
+				sizeof(*metrics->records) * metrics->max_records);
+		assert(metrics->records);
+	}
+	metrics->records[metrics->nr_records++] = *record;
+}
+
+static unsigned int __value(const struct metrics_record *record, enum metric metric)
+{
+	switch (metric) {
+	case METRIC_TURNAROUND:
+		return record->completion - record->arrival;
+	case METRIC_WAITING:
+		return record->completion - record->arrival - record->lifespan;
+	case METRIC_RESPONSE:
+		return record->first_run - record->arrival;
+	case METRIC_BLOCKED:
+		return record->blocked;
+	case METRIC_PREEMPTIONS:
+		return record->nr_preemptions;
+	default:
+		assert(0 && "Unknown metric");
+		return 0;
+	}
+}
+
+static int __compare_value(const void *a, const void *b)
+{
+	unsigned int va = *(const unsigned int *)a, vb = *(const unsigned int *)b;
+
+	return va < vb ? -1 : va > vb;
+}
+
+/**
+ * The smallest value that @percent % of the sorted @values are not above
+ */
+static inline unsigned int __percentile(unsigned int *values, unsigned int nr_values,
+		unsigned int percent)
+{
+	unsigned long long rank = ((unsigned long long)nr_values * percent + 99) / 100;
+
+	return values[rank ? rank - 1 : 0];
+}
+
+void metrics_summarize(struct metrics *metrics, enum metric metric,
+		struct metrics_summary *summary)
+{
+	unsigned int *values;
+	unsigned long long total = 0;
+	unsigned int n = metrics->nr_records;
+
+	summary->avg = 0.0;
+	summary->p50 = summary->p95 = summary->p99 = summary->max = 0;
+	if (!n) return;
+
+	values = malloc(sizeof(*values) * n);
+	assert(values);
+
+	for (unsigned int i = 0; i < n; i++) {
+		values[i] = __value(metrics->records + i, metric);
+		total += values[i];
+	}
+	qsort(values, n, sizeof(*values), __compare_value);
+
+	summary->avg = (double)total / n;
+	summary->p50 = __percentile(values, n, 50);
+	summary->p95 = __percentile(values, n, 95);
+	summary->p99 = __percentile(values, n, 99);
+	summary->max = values[n - 1];
+
+	free(values);
+}
+
+/**
+ * Compare the share of the CPU each process got with what it deserved over
+ * its lifetime, in the order of the completion
+ */
+static void __report_shares(FILE *out, struct metrics *metrics)
+{
+	unsigned int i;
+
+	for (i = 0; i < metrics->nr_records; i++) {
+		if (metrics->records[i].entitled > 0) break;
+	}
+	if (i == metrics->nr_records) return;
+
+	fprintf(out, "\n");
+	fprintf(out, "  %6s %10s %10s %10s %8s %8s\n",
+			"PID", "Lifetime", "Ran", "Entitled", "Share", "Deserved");
+
+	for (i = 0; i < metrics->nr_records; i++) {
+		struct metrics_record *record = metrics->records + i;
+		unsigned int lifetime = record->completion - record->arrival;
+
+		fprintf(out, "  %6u %10u %10u %10.1f %7.1f%% %7.1f%%\n",
+				record->pid, lifetime, record->lifespan, record->entitled,
+				lifetime ? 100.0 * record->lifespan / lifetime : 0.0,
+				lifetime ? 100.0 * record->entitled / lifetime : 0.0);
+	}
+}
+
+void metrics_report(FILE *out, struct metrics *metrics)
+{
+	fprintf(out, "\n");
+	fprintf(out, "****************************************************\n");
+	fprintf(out, "  Metrics over %u completed process%s\n\n",
+			metrics->nr_records, metrics->nr_records == 1 ? "" : "es");
+	fprintf(out, "  %-12s %10s %8s %8s %8s %8s\n",
+			"Metric", "Avg", "p50", "p95", "p99", "Max");
+
+	for (int i = 0; i < NR_METRICS; i++) {
+		struct metrics_summary summary;
+
+		metrics_summarize(metrics, i, &summary);
+		fprintf(out, "  %-12s %10.2f %8u %8u %8u %8u\n", __metric_sz[i],
+				summary.avg, summary.p50, summary.p95, summary.p99, summary.max);
+	}
+
+	__report_shares(out, metrics);
+}
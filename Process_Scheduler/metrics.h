@@ -0,0 +1,121 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+/***********************************************************************
+ * struct metrics_record
+ *
+ * DESCRIPTION
+ *   What a process went through from its arrival to its completion.
+ *   Times are in ticks.
+ */
+struct metrics_record {
+	unsigned int pid;
+	unsigned int lifespan;
+	unsigned int arrival;		/* When the process was forked */
+	unsigned int first_run;		/* When the process got a CPU first */
+	unsigned int completion;	/* When the process exited */
+	unsigned int blocked;		/* # of ticks blocked on resources */
+	unsigned int nr_preemptions;	/* # of times taken off a CPU while runnable */
+	double entitled;		/* Ticks of the CPU the process deserved by its share.
+					   0 if the scheduler does not tell */
+};
+
+/**
+ * Metrics derived from the records
+ */
+enum metric {
+	METRIC_TURNAROUND,	/* From the arrival to the completion */
+	METRIC_WAITING,		/* Not running between the arrival and the completion */
+	METRIC_RESPONSE,	/* From the arrival to the first run */
+	METRIC_BLOCKED,
+	METRIC_PREEMPTIONS,
+	NR_METRICS,
+};
+
+struct metrics_summary {
+	double avg;
+	unsigned int p50;
+	unsigned int p95;
+	unsigned int p99;
+	unsigned int max;
+};
+
+/***********************************************************************
+ * struct metrics
+ *
+ * DESCRIPTION
+ *   Records of the processes completed in a simulation in the order of
+ *   their completion
+ */
+struct metrics {
+	unsigned int nr_records;
+	unsigned int max_records;
+	struct metrics_record *records;
+};
+
+
+/***********************************************************************
+ * metrics_create()
+ *
+ * DESCRIPTION
+ *   Create an empty set of records
+ */
+struct metrics *metrics_create(void);
+
+
+/***********************************************************************
+ * metrics_destroy()
+ *
+ * DESCRIPTION
+ *   Free @metrics with its records
+ */
+void metrics_destroy(struct metrics *metrics);
+
+
+/***********************************************************************
+ * metrics_add()
+ *
+ * DESCRIPTION
+ *   Append a copy of @record to @metrics
+ */
+void metrics_add(struct metrics *metrics, const struct metrics_record *record);
+
+
+/***********************************************************************
+ * metrics_summarize()
+ *
+ * DESCRIPTION
+ *   Summarize @metric over the records in @metrics into @summary. The
+ *   percentiles are taken by the nearest rank. All zero with no record.
+ */
+void metrics_summarize(struct metrics *metrics, enum metric metric,
+		struct metrics_summary *summary);
+
+
+/***********************************************************************
+ * metrics_report()
+ *
+ * DESCRIPTION
+ *   Print the summary of every metric in @metrics to @out. The share of
+ *   the CPU each process got over its lifetime is compared with its
+ *   entitled share as well if the scheduler told the entitlements.
+ */
+void metrics_report(FILE *out, struct metrics *metrics);
+
+#endif
@@ -17,44 +17,158 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <assert.h>
 
 #include "types.h"
 #include "list_head.h"
+#include "heap.h"
 
-/**
- * The process which is currently running
- */
 #include "process.h"
-extern struct process *current;
+#include "resource.h"
+#include "prio_array.h"
+#include "cpu.h"
+
 
+/**
+ * Simulation this scheduler runs in. The current process, runqueues,
+ * resources, and ticks are all reached through the CPU given to the
+ * callbacks; @cpu->sim->resources, @cpu->sim->ticks, and so on.
+ */
+#include "sim.h"
 
 /**
- * List head to hold the processes ready to run
+ * A resource has @capacity units and each exclusive acquire takes one of
+ * them. The process holding a single-unit resource is its @owner, whereas
+ * the holders of a multi-unit one are just counted. Processes acquiring in
+ * the shared mode (@p->shared) hold the resource together while no unit is
+ * taken, and they are counted in @nr_readers. Readers do not get in while
+ * writers wait with RW_PREFER_WRITERS
  */
-extern struct list_head readyqueue;
+static bool resource_available(struct sim *sim, struct resource *r, struct process *p)
+{
+	if (p->shared) {
+		if (r->nr_holders) return false;
+		if (sim->rw_preference == RW_PREFER_READERS) return true;
+
+		return list_empty(&r->waitqueue) && heap_empty(&r->waiters);
+	}
+	return !r->nr_readers && r->nr_holders < r->capacity;
+}
+
+static void resource_get(struct sim *sim, struct resource *r, struct process *p)
+{
+	assert(resource_available(sim, r, p));
 
+	if (p->shared) {
+		r->nr_readers++;
+		return;
+	}
+	if (r->capacity == 1) r->owner = p;
+	r->nr_holders++;
+}
 
 /**
- * Resources in the system.
+ * Waiters a release can wake up. A writer is woken up for each unit freed,
+ * whereas the readers are woken up all together if no writer is
  */
-#include "resource.h"
-extern struct resource resources[NR_RESOURCES];
+struct wakeup {
+	unsigned int nr_units;	/* Units freed and not given to writers yet */
+	bool readers;		/* The readers may be woken up */
+};
 
+/**
+ * Give back what @p holds of @r. A unit is freed for an exclusive release,
+ * and all of them for the last reader leaving
+ */
+static struct wakeup resource_put(struct resource *r, struct process *p)
+{
+	struct wakeup wakeup = { .nr_units = 1, .readers = true };
+
+	if (p->shared) {
+		assert(r->nr_readers > 0);
+
+		if (--r->nr_readers) wakeup.nr_units = 0;
+		else wakeup.nr_units = r->capacity;
+		return wakeup;
+	}
+
+	/* Ensure that the owner process is releasing the resource */
+	assert(r->nr_holders > 0);
+	assert(r->capacity > 1 || r->owner == p);
+
+	r->owner = NULL;
+	r->nr_holders--;
+	return wakeup;
+}
+
+enum wakeup_mode {
+	WAKE_NONE,
+	WAKE_WRITER,
+	WAKE_READER,
+};
 
 /**
- * Monotonically increasing ticks
+ * Tell who of @r to wake up next out of what @wakeup leaves. @writers and
+ * @readers tell whether any waits in each mode. The preferred mode goes
+ * first, and waking up one mode leaves nothing for the other
  */
-extern unsigned int ticks;
+static enum wakeup_mode resource_next_wakeup(struct sim *sim, struct resource *r,
+		bool writers, bool readers, struct wakeup *wakeup)
+{
+	if (readers && wakeup->readers && !r->nr_holders &&
+			(sim->rw_preference == RW_PREFER_READERS || !writers)) {
+		wakeup->nr_units = 0;
+		return WAKE_READER;
+	}
+	if (writers && !r->nr_readers && wakeup->nr_units > 0) {
+		wakeup->nr_units--;
+		wakeup->readers = false;
+		return WAKE_WRITER;
+	}
+	return WAKE_NONE;
+}
 
+/**
+ * Put @p to wait for @r on @waitqueue or @shared_waitqueue in the order of
+ * arrival
+ */
+static void fcfs_wait(struct resource *r, struct process *p)
+{
+	p->status = PROCESS_WAIT;
+	list_add_tail(&p->list, p->shared ? &r->shared_waitqueue : &r->waitqueue);
+}
 
 /**
- * Quiet mode. True if the program was started with -q option
+ * Take the next waiter to wake up out of @r, or NULL if @wakeup has no
+ * more to wake up
  */
-extern bool quiet;
+static struct process *fcfs_wake_up(struct sim *sim, struct resource *r, struct wakeup *wakeup)
+{
+	struct process *waiter;
+	enum wakeup_mode mode = resource_next_wakeup(sim, r, !list_empty(&r->waitqueue),
+			!list_empty(&r->shared_waitqueue), wakeup);
+
+	if (mode == WAKE_NONE) return NULL;
+
+	waiter = list_first_entry(mode == WAKE_READER ? &r->shared_waitqueue : &r->waitqueue,
+			struct process, list);
+
+	/**
+	 * Ensure the waiter is in the wait status
+	 */
+	assert(waiter->status == PROCESS_WAIT);
+
+	/**
+	 * Take out the waiter from the waiting queue. Note we use
+	 * list_del_init() over list_del() to maintain the list head tidy
+	 * (otherwise, the framework will complain on the list head
+	 * when the process exits).
+	 */
+	list_del_init(&waiter->list);
+	return waiter;
+}
 
-int mark[1000] = { 0 };
-int change[1000] = { 0 };
 /***********************************************************************
  * Default FCFS resource acquision function
  *
@@ -64,23 +178,23 @@ int change[1000] = { 0 };
  *   The current implementation serves the resource in the requesting order
  *   without considering the priority. See the comments in sched.h
  ***********************************************************************/
-bool fcfs_acquire(int resource_id)
+bool fcfs_acquire(struct cpu *cpu, int resource_id)
 {
-	struct resource *r = resources + resource_id;
+	struct resource *r = cpu->sim->resources + resource_id;
 
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
+	if (resource_available(cpu->sim, r, cpu->current)) {
+		/* The resource can be held in the mode asked for. Take it! */
+		resource_get(cpu->sim, r, cpu->current);
 		return true;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
-
-	/* Update the current process state */
-	current->status = PROCESS_WAIT;
+	/* OK, the resource is taken in a way to keep us out. */
 
-	/* And append current to waitqueue */
-	list_add_tail(&current->list, &r->waitqueue);
+	/**
+	 * Update the current process state and append current to the
+	 * waitqueue of its mode
+	 */
+	fcfs_wait(r, cpu->current);
 
 	/**
 	 * And return false to indicate the resource is not available.
@@ -99,34 +213,20 @@ bool fcfs_acquire(int resource_id)
  *   The current implementation serves the resource in the requesting order
  *   without considering the priority. See the comments in sched.h
  ***********************************************************************/
-void fcfs_release(int resource_id)
+void fcfs_release(struct cpu *cpu, int resource_id)
 {
-	struct resource *r = resources + resource_id;
-
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct process *waiter;
+	struct wakeup wakeup;
 
 	/* Un-own this resource */
-	r->owner = NULL;
-
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue)) {
-		struct process *waiter =
-				list_first_entry(&r->waitqueue, struct process, list);
-
-		/**
-		 * Ensure the waiter is in the wait status
-		 */
-		assert(waiter->status == PROCESS_WAIT);
-
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
+	wakeup = resource_put(r, cpu->current);
 
+	/**
+	 * Let's wake up the waiters that came first; ONE writer for the unit
+	 * freed, or all the readers at once
+	 */
+	while ((waiter = fcfs_wake_up(cpu->sim, r, &wakeup))) {
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
 
@@ -134,32 +234,115 @@ void fcfs_release(int resource_id)
 		 * Put the waiter process into ready queue. The framework will
 		 * do the rest.
 		 */
-		list_add_tail(&waiter->list, &readyqueue);
+		list_add_tail(&waiter->list, &waiter->cpu->readyqueue);
+	}
+}
+
+/***********************************************************************
+ * Default runqueue functions for the load balancer
+ *
+ * DESCRIPTION
+ *   These work on @cpu->readyqueue, so they serve the schedulers keeping
+ *   the ready processes in the queue. The process at the tail is the one
+ *   to run last, so it is given away first. See the comments in sched.h
+ ***********************************************************************/
+unsigned int fcfs_nr_ready(struct cpu *cpu)
+{
+	struct process *p;
+	unsigned int nr_ready = 0;
+
+	list_for_each_entry(p, &cpu->readyqueue, list) {
+		nr_ready++;
 	}
+	return nr_ready;
+}
+
+struct process *fcfs_steal(struct cpu *cpu)
+{
+	struct process *p;
+
+	if (list_empty(&cpu->readyqueue)) return NULL;
+
+	p = list_last_entry(&cpu->readyqueue, struct process, list);
+	list_del_init(&p->list);
+	return p;
+}
+
+void fcfs_enqueue(struct cpu *cpu, struct process *p)
+{
+	list_add_tail(&p->list, &cpu->readyqueue);
 }
 
 
 
 #include "sched.h"
 
+/***********************************************************************
+ * Heap-ordered runqueue helpers
+ *
+ * DESCRIPTION
+ *   Processes on a heap-ordered runqueue are sorted by @rq_key, and the
+ *   one enqueued earlier comes first among those with the same key.
+ ***********************************************************************/
+static bool heap_rq_less(struct heap_node *a, struct heap_node *b)
+{
+	struct process *pa = container_of(a, struct process, rq_node);
+	struct process *pb = container_of(b, struct process, rq_node);
+
+	if (pa->rq_key != pb->rq_key) return pa->rq_key < pb->rq_key;
+	return pa->rq_seq < pb->rq_seq;
+}
+
+static void heap_rq_enqueue(struct cpu *cpu, struct process *p, long long key)
+{
+	assert(list_empty(&p->list));
+
+	p->rq_key = key;
+	p->rq_seq = cpu->heap_seq++;
+	heap_push(&cpu->heap, &p->rq_node);
+}
+
+static struct process *heap_rq_peek(struct heap *rq)
+{
+	return heap_entry(heap_peek(rq), struct process, rq_node);
+}
+
+/**
+ * The process to run last on @rq, which is the one to give away first
+ */
+static struct process *heap_rq_peek_last(struct heap *rq)
+{
+	struct heap_node *node = heap_peek_last(rq);
+
+	return heap_entry(node, struct process, rq_node);
+}
+
+static void heap_rq_dequeue(struct heap *rq, struct process *p)
+{
+	heap_remove(rq, &p->rq_node);
+}
+
+
 /***********************************************************************
  * FIFO scheduler
  ***********************************************************************/
-static int fifo_initialize(void)
+static int fifo_initialize(struct cpu *cpu)
 {
+	(void)cpu;
 	return 0;
 }
 
-static void fifo_finalize(void)
+static void fifo_finalize(struct cpu *cpu)
 {
+	(void)cpu;
 }
 
-static struct process *fifo_schedule(void)
+static struct process *fifo_schedule(struct cpu *cpu)
 {
 	struct process *next = NULL;
 
 	/* You may inspect the situation by calling dump_status() at any time */
-	// dump_status();
+	// dump_status(cpu->sim);
 
 	/**
 	 * When there was no process to run in the previous tick (so does
@@ -170,24 +353,24 @@ static struct process *fifo_schedule(void)
 	 * to the waitqueue of the corresponding resource. In this case just
 	 * pick the next as well.
 	 */
-	if (!current || current->status == PROCESS_WAIT) {
+	if (!cpu->current || cpu->current->status == PROCESS_WAIT) {
 		goto pick_next;
 	}
 
 	/* The current process has remaining lifetime. Schedule it again */
-	if (current->age < current->lifespan) {
-		return current;
+	if (cpu->current->age < cpu->current->lifespan) {
+		return cpu->current;
 	}
 
 pick_next:
 	/* Let's pick a new process to run next */
 
-	if (!list_empty(&readyqueue)) {
+	if (!list_empty(&cpu->readyqueue)) {
 		/**
 		 * If the ready queue is not empty, pick the first process
 		 * in the ready queue
 		 */
-		next = list_first_entry(&readyqueue, struct process, list);
+		next = list_first_entry(&cpu->readyqueue, struct process, list);
 
 		/**
 		 * Detach the process from the ready queue. Note we use list_del_init()
@@ -201,6 +384,16 @@ pick_next:
 	return next;
 }
 
+/**
+ * Non-preemptive schedulers keep the current running until something
+ * happens. Used for the event-driven simulation
+ */
+static unsigned int nonpreemptive_timeslice(struct cpu *cpu)
+{
+	(void)cpu;
+	return UINT_MAX;
+}
+
 struct scheduler fifo_scheduler = {
 	.name = "FIFO",
 	.acquire = fcfs_acquire,
@@ -208,6 +401,10 @@ struct scheduler fifo_scheduler = {
 	.initialize = fifo_initialize,
 	.finalize = fifo_finalize,
 	.schedule = fifo_schedule,
+	.timeslice = nonpreemptive_timeslice,
+	.nr_ready = fcfs_nr_ready,
+	.steal = fcfs_steal,
+	.enqueue = fcfs_enqueue,
 };
 
 
@@ -215,47 +412,104 @@ struct scheduler fifo_scheduler = {
  * SJF scheduler
  ***********************************************************************/
 
-static struct process *sjf_schedule(void)
+/**
+ * SJF and SRTF keep the ready processes on @cpu->heap. The processes that
+ * become ready are appended to @cpu->readyqueue by the framework and
+ * fcfs_release(), and they are moved onto the heap in that order when the
+ * next process is picked.
+ */
+static int sjf_initialize(struct cpu *cpu)
+{
+	heap_init(&cpu->heap, heap_rq_less);
+	return 0;
+}
+
+static void sjf_finalize(struct cpu *cpu)
+{
+	heap_destroy(&cpu->heap);
+}
+
+static long long sjf_key(struct process *p)
+{
+	return p->lifespan;
+}
+
+static long long srtf_key(struct process *p)
+{
+	return p->lifespan - p->age;
+}
+
+static void sjf_sort_latecomers(struct cpu *cpu, long long (*key)(struct process *))
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &cpu->readyqueue, list) {
+		list_del_init(&p->list);
+		heap_rq_enqueue(cpu, p, key(p));
+	}
+}
+
+static struct process *sjf_pick_next(struct cpu *cpu, long long (*key)(struct process *))
+{
+	struct process *next;
+
+	sjf_sort_latecomers(cpu, key);
+
+	next = heap_rq_peek(&cpu->heap);
+	if (next) {
+		heap_rq_dequeue(&cpu->heap, next);
+	}
+	return next;
+}
+
+static unsigned int sjf_nr_ready(struct cpu *cpu)
+{
+	return fcfs_nr_ready(cpu) + cpu->heap.nr_nodes;
+}
+
+static struct process *sjf_steal(struct cpu *cpu)
+{
+	struct process *p;
+
+	/* Give away the latecomers first as they are not sorted yet */
+	p = fcfs_steal(cpu);
+	if (p) return p;
+
+	p = heap_rq_peek_last(&cpu->heap);
+	if (p) {
+		heap_rq_dequeue(&cpu->heap, p);
+	}
+	return p;
+}
+
+static struct process *sjf_schedule(struct cpu *cpu)
 {
 	/**
 	 * Implement your own SJF scheduler here.
 	 */
 	
-	struct process *next = NULL;
-
-        if(!current || current->status == PROCESS_WAIT){
+        if(!cpu->current || cpu->current->status == PROCESS_WAIT){
                 goto pick_next;
         }
 
-        if (current->age < current->lifespan) {
-                return current;
+        if (cpu->current->age < cpu->current->lifespan) {
+                return cpu->current;
         }
 
 pick_next :
-	if(!list_empty(&readyqueue)){
-
-		struct process *p; //순회용 process
-		
-		//find minimum lifespan process
-		unsigned int min_lifespan = 1000;
-		list_for_each_entry(p, &readyqueue, list){
-			if(p->lifespan < min_lifespan)
-			{
-				next = p;
-				min_lifespan = p->lifespan;
-			}
-		}
-		list_del_init(&next->list);
-		return next;
-
-	}
-	return next;
+	return sjf_pick_next(cpu, sjf_key);
 }
 
 struct scheduler sjf_scheduler = {
 	.name = "Shortest-Job First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = sjf_initialize,
+	.finalize = sjf_finalize,
+	.timeslice = nonpreemptive_timeslice,
+	.nr_ready = sjf_nr_ready,
+	.steal = sjf_steal,
+	.enqueue = fcfs_enqueue,
 	.schedule = sjf_schedule,		 /* TODO: Assign sjf_schedule()
 								to this function pointer to activate
 								SJF in the system */
@@ -265,52 +519,31 @@ struct scheduler sjf_scheduler = {
 /***********************************************************************
  * SRTF scheduler
  ***********************************************************************/
-static struct process *srtf_schedule(void)
+static struct process *srtf_schedule(struct cpu *cpu)
 {
 
-	struct process *next = NULL;
-	
-        if(!current || current->status == PROCESS_WAIT){
+        if(!cpu->current || cpu->current->status == PROCESS_WAIT){
                 goto pick_next;
         }
 
-        if (current->age < current->lifespan) {
-                return current;
+        if (cpu->current->age < cpu->current->lifespan) {
+                return cpu->current;
         }
 
 pick_next :
-        if(!list_empty(&readyqueue)){
-
-                struct process *p; //순회용 process
-
-                //find minimum remain process
-                unsigned int min_remain = 1000;
-                list_for_each_entry(p, &readyqueue, list){
-                        if(p->lifespan - p->age < min_remain)
-                        {
-                                next = p;
-                                min_remain = p->lifespan - p->age;
-                        }
-                }
-		
-                list_del_init(&next->list);
-                return next;
-
-        }
-        return next;	
-
+	return sjf_pick_next(cpu, srtf_key);
 }
 
-void preemptive_remain(struct process* p)
+void preemptive_remain(struct cpu *cpu, struct process *p)
 {
-	if(current != NULL){
+	if(cpu->current != NULL){
 
-		if(p->lifespan < current->lifespan - current->age)
+		if(p->lifespan < cpu->current->lifespan - cpu->current->age)
 		{
-			current->status = PROCESS_WAIT;
-			list_move_tail(&current->list, &readyqueue);
-			current = p;
-			list_del_init(&current->list);
+			cpu->current->status = PROCESS_WAIT;
+			list_move_tail(&cpu->current->list, &cpu->readyqueue);
+			cpu->current = p;
+			list_del_init(&cpu->current->list);
 		}
 	}	
 }
@@ -319,7 +552,13 @@ struct scheduler srtf_scheduler = {
 	.name = "Shortest Remaining Time First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = sjf_initialize,
+	.finalize = sjf_finalize,
 	.schedule = srtf_schedule, 
+	.timeslice = nonpreemptive_timeslice,
+	.nr_ready = sjf_nr_ready,
+	.steal = sjf_steal,
+	.enqueue = fcfs_enqueue,
 	.forked = preemptive_remain,
 	/* You need to check the newly created processes to implement SRTF.
 	 * Use @forked() callback to mark newly created processes */
@@ -327,210 +566,366 @@ struct scheduler srtf_scheduler = {
 };
 
 
+/***********************************************************************
+ * Earliest-deadline-first scheduler
+ ***********************************************************************/
+
+/**
+ * The ready processes are on @cpu->heap ordered by their absolute deadline
+ * as SJF does by the lifespan. Those without a deadline come last in the
+ * forking order. A process becoming ready with an earlier deadline than the
+ * current preempts it
+ */
+static long long edf_key(struct process *p)
+{
+	return p->deadline;
+}
+
+static struct process *edf_schedule(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *next;
+
+	sjf_sort_latecomers(cpu, edf_key);
+
+	if (!curr || curr->status == PROCESS_WAIT || curr->age >= curr->lifespan) {
+		goto pick_next;
+	}
+
+	next = heap_rq_peek(&cpu->heap);
+	if (!next || next->deadline >= curr->deadline) {
+		return curr;
+	}
+	heap_rq_enqueue(cpu, curr, edf_key(curr));
+
+pick_next:
+	return sjf_pick_next(cpu, edf_key);
+}
+
+static unsigned int edf_timeslice(struct cpu *cpu)
+{
+	struct process *next = heap_rq_peek(&cpu->heap);
+
+	/* Someone woken up by other CPUs is not sorted yet */
+	if (!list_empty(&cpu->readyqueue)) return 0;
+
+	if (next && next->deadline < cpu->current->deadline) return 0;
+	return UINT_MAX;
+}
+
+struct scheduler edf_scheduler = {
+	.name = "Earliest Deadline First",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = sjf_initialize,
+	.finalize = sjf_finalize,
+	.schedule = edf_schedule,
+	.timeslice = edf_timeslice,
+	.nr_ready = sjf_nr_ready,
+	.steal = sjf_steal,
+	.enqueue = fcfs_enqueue,
+};
+
+
 /***********************************************************************
  * Round-robin scheduler
  ***********************************************************************/
-static struct process *rr_schedule(void)
+static struct process *rr_schedule(struct cpu *cpu)
 {
 
 	struct process *next = NULL;
 	
-	if(!current || current->status == PROCESS_WAIT){
+	if(!cpu->current || cpu->current->status == PROCESS_WAIT){
 		goto pick_next;
 	}
 	
-	if(current->age < current->lifespan){
-		//quantum=1
-		current->status = PROCESS_WAIT;
-		list_move_tail(&current->list, &readyqueue);
+	if(cpu->current->age < cpu->current->lifespan){
+		unsigned int used = cpu->current->age - cpu->current->slice_start;
+
+		//a process alone gets a new slice whenever one expires. Roll them
+		//forward if the ticks have been skipped meanwhile
+		if(used > cpu->sim->quantum){
+			cpu->current->slice_start += (used - 1) / cpu->sim->quantum * cpu->sim->quantum;
+			used = cpu->current->age - cpu->current->slice_start;
+		}
+
+		//keep running until the quantum expires
+		if(used < cpu->sim->quantum){
+			return cpu->current;
+		}
+		cpu->current->status = PROCESS_WAIT;
+		list_move_tail(&cpu->current->list, &cpu->readyqueue);
 		
 		//next process!
-		next = list_first_entry(&readyqueue, struct process, list);
+		next = list_first_entry(&cpu->readyqueue, struct process, list);
 		list_del_init(&next->list);
+		next->slice_start = next->age;
 		return next;
 	}
 
 
 pick_next :
-	if(!list_empty(&readyqueue)){
-		next = list_first_entry(&readyqueue, struct process, list);
+	if(!list_empty(&cpu->readyqueue)){
+		next = list_first_entry(&cpu->readyqueue, struct process, list);
 		
 		list_del_init(&next->list);
+		next->slice_start = next->age;
 	}
 
 	
 	return next;
 }
 
+static unsigned int rr_timeslice(struct cpu *cpu)
+{
+	unsigned int used = cpu->current->age - cpu->current->slice_start;
+
+	/* The current gets picked again if no one else is waiting */
+	if (list_empty(&cpu->readyqueue)) return UINT_MAX;
+
+	/* or, until its quantum expires */
+	return used < cpu->sim->quantum ? cpu->sim->quantum - used : 0;
+}
+
 struct scheduler rr_scheduler = {
 	.name = "Round-Robin",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
 	/* Obviously, you should implement rr_schedule() and attach it here */
 	.schedule = rr_schedule,
+	.timeslice = rr_timeslice,
+	.nr_ready = fcfs_nr_ready,
+	.steal = fcfs_steal,
+	.enqueue = fcfs_enqueue,
 };
 
 
 /***********************************************************************
  * Priority scheduler
  ***********************************************************************/
-static struct process *prio_schedule(void)
+
+/**
+ * The priority-based schedulers link the ready processes to the level of
+ * their priority on @cpu->prio_array instead of @cpu->readyqueue
+ */
+static int prio_initialize(struct cpu *cpu)
+{
+	prio_array_init(&cpu->prio_array);
+	return 0;
+}
+
+static struct process *prio_schedule(struct cpu *cpu)
 {
 	struct process *next = NULL;
 
 	//fprintf(stderr,"tick:%d\n",ticks);
-	//dump_status();
-	if(!current || current->status == PROCESS_WAIT){
+	//dump_status(cpu->sim);
+	if(!cpu->current || cpu->current->status == PROCESS_WAIT){
 		goto pick_next;
 	}
 
-	if(current->age < current->lifespan){
+	if(cpu->current->age < cpu->current->lifespan){
 		
-		struct process *tmp;
-		unsigned int max = 0;
-		bool check2 = false;
-		list_for_each_entry(tmp, &readyqueue, list){
-			if(tmp->prio > max){
-				max = tmp->prio;
-				next = tmp;
-				check2 = true;
-			}
-			if(tmp->prio == 0 && check2 == false)
-			{
-				next = tmp;
-				max = tmp->prio;
-				check2 = true;
-			}
-		}
-		if (max == current->prio && !list_empty(&readyqueue))
+		unsigned int max;
+
+		next = prio_array_peek(&cpu->prio_array);
+		max = next ? next->prio : 0;
+
+		if (max == cpu->current->prio && next)
 		{
-			current->status = PROCESS_WAIT;
-			list_move_tail(&current->list, &readyqueue);
+			cpu->current->status = PROCESS_WAIT;
+			prio_array_enqueue(&cpu->prio_array, cpu->current);
 
-			list_del_init(&next->list);
+			prio_array_dequeue(&cpu->prio_array, next);
 
 			return next;
 		}
-		if(change[current->pid] == 1)
+		if(cpu->current->prio_dropped)
 		{
-			if(current->prio > next->prio)
+			if(!next || cpu->current->prio > next->prio)
 			{
-				change[current->pid] = 0;
-				return current;
+				cpu->current->prio_dropped = false;
+				return cpu->current;
 			}
-			current->status = PROCESS_WAIT;
-			list_move_tail(&current->list, &readyqueue);
+			cpu->current->status = PROCESS_WAIT;
+			prio_array_enqueue(&cpu->prio_array, cpu->current);
 			
-			change[current->pid] = 0;
-			list_del_init(&next->list);
+			cpu->current->prio_dropped = false;
+			prio_array_dequeue(&cpu->prio_array, next);
 			return next;
 		}
-		//dump_status();
+		//dump_status(cpu->sim);
 
-		return current;
+		return cpu->current;
 	}
 	
 pick_next :
-	if(!list_empty(&readyqueue)){
-
-		struct process *p;
-		//dump_status();
-		bool check = false;
-		unsigned int max_prio = 0;
-		list_for_each_entry(p, &readyqueue, list){
-			if(p->prio > max_prio)
-			{	
-				next = p;
-				max_prio = p->prio;
-				check = true;
-			}
-			if(p->prio == 0 && check == false)
-			{
-				next = p;
-				max_prio = p->prio;
-				check = true;
-			}
-		}
-	
-		list_del_init(&next->list);
-	//	dump_status();
-		return next;
+	next = prio_array_peek(&cpu->prio_array);
+	if(next){
+		prio_array_dequeue(&cpu->prio_array, next);
 	}
 	return next;
 
 }
 
-bool prio_acquire(int resource_id)
+/**
+ * Heap of @r that @p waits on in its mode
+ */
+static inline struct heap *prio_waiters(struct resource *r, struct process *p)
 {
-	struct resource *r = resources + resource_id;
+	return p->shared ? &r->shared_waiters : &r->waiters;
+}
 
-	if(!r->owner){
-		r->owner = current;
-		return true;
-	}
+/**
+ * Waiter of the highest priority on @r in either mode. NULL if none
+ */
+static struct process *prio_top_waiter(struct resource *r)
+{
+	struct process *writer = heap_entry(heap_peek(&r->waiters), struct process, rq_node);
+	struct process *reader = heap_entry(heap_peek(&r->shared_waiters), struct process, rq_node);
 
-	current->status = PROCESS_WAIT;
+	if (!writer) return reader;
+	if (!reader) return writer;
+	return reader->prio > writer->prio ? reader : writer;
+}
 
-	mark[current->pid] = 1;
-	list_move_tail(&current->list, &r->waitqueue);
+/**
+ * Put @p to wait for @r behind the waiters of the same priority
+ */
+static void prio_wait(struct resource *r, struct process *p)
+{
+	assert(list_empty(&p->list));
 
-	return false;
+	p->rq_seq = r->seq++;
+	p->waiting_for = r;
+	heap_push(prio_waiters(r, p), &p->rq_node);
 }
 
-void prio_release(int resource_id)
+/**
+ * Take the waiter of the highest priority in the mode to wake up out of
+ * @r in O(log n), or NULL if @wakeup has no more to wake up
+ */
+static struct process *prio_wake_up(struct sim *sim, struct resource *r, struct wakeup *wakeup)
 {
-	struct resource *r = resources + resource_id;
+	enum wakeup_mode mode = resource_next_wakeup(sim, r, !heap_empty(&r->waiters),
+			!heap_empty(&r->shared_waiters), wakeup);
+	struct heap_node *node;
+	struct process *waiter;
 
-	assert(r->owner == current);
+	if (mode == WAKE_NONE) return NULL;
 
-	r->owner = NULL;
-	
-	if(!list_empty(&r->waitqueue)){
+	node = heap_pop(mode == WAKE_READER ? &r->shared_waiters : &r->waiters);
+	waiter = heap_entry(node, struct process, rq_node);
 
-		unsigned int max_pri = 0;
-		struct process *waiter, *max_waiter;
-		//maximum priority
-		list_for_each_entry(waiter,&r->waitqueue,list){
-			if(max_pri < waiter->prio)
-			{
-				max_pri = waiter->prio;
-				max_waiter = waiter;
-			}
-		}
-		assert(max_waiter->status == PROCESS_WAIT);
-		
-		mark[max_waiter->pid] = 0;
-		list_del_init(&max_waiter->list);
-		max_waiter->status = PROCESS_READY;
-		list_add_tail(&max_waiter->list, &readyqueue);
-	}
+	assert(waiter->status == PROCESS_WAIT);
+	waiter->waiting_for = NULL;
+	return waiter;
 }
 
-void preemptive_prio(struct process *p)
+/**
+ * Wake up the waiters of @r onto the priority arrays of their CPUs
+ */
+static void prio_wake_up_all(struct sim *sim, struct resource *r, struct wakeup wakeup)
 {
+	struct process *waiter;
 
-	if (current != NULL){
-		//dump_status();
-		if(p->prio > current->prio)
-		{
-			if(mark[current->pid] == 0){
-				current->status = PROCESS_WAIT;
-				list_move_tail(&current->list,&readyqueue);
-				
-				current = p;
-				list_del_init(&current->list);
-			}
-		}
-			
+	while ((waiter = prio_wake_up(sim, r, &wakeup))) {
+		waiter->blocked = false;
+		waiter->status = PROCESS_READY;
+		prio_array_enqueue(&waiter->cpu->prio_array, waiter);
 	}
 }
 
-struct scheduler prio_scheduler = {
-	.name = "Priority",
-	.acquire = prio_acquire,
-	.release = prio_release,
-	.schedule = prio_schedule,
-	.forked = preemptive_prio,
+bool prio_acquire(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+
+	if (resource_available(cpu->sim, r, cpu->current)) {
+		resource_get(cpu->sim, r, cpu->current);
+		return true;
+	}
+
+	cpu->current->status = PROCESS_WAIT;
+
+	cpu->current->blocked = true;
+	prio_wait(r, cpu->current);
+
+	return false;
+}
+
+void prio_release(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct wakeup wakeup = resource_put(r, cpu->current);
+
+	prio_wake_up_all(cpu->sim, r, wakeup);
+}
+
+void preemptive_prio(struct cpu *cpu, struct process *p)
+{
+	/* Take the newly forked process from @readyqueue to the priority array */
+	list_del_init(&p->list);
+
+	if (cpu->current != NULL){
+		//dump_status(cpu->sim);
+		if(p->prio > cpu->current->prio)
+		{
+			if(!cpu->current->blocked){
+				cpu->current->status = PROCESS_WAIT;
+				list_del_init(&cpu->current->list);
+				prio_array_enqueue(&cpu->prio_array, cpu->current);
+				
+				cpu->current = p;
+				return;
+			}
+		}
+			
+	}
+	prio_array_enqueue(&cpu->prio_array, p);
+}
+
+static unsigned int prio_timeslice(struct cpu *cpu)
+{
+	struct process *next = prio_array_peek(&cpu->prio_array);
+
+	/* Round-robin with the same priority, or reconsider the dropped one */
+	if ((next && next->prio == cpu->current->prio) || cpu->current->prio_dropped) {
+		return 1;
+	}
+	return UINT_MAX;
+}
+
+static unsigned int prio_nr_ready(struct cpu *cpu)
+{
+	return cpu->prio_array.nr_active;
+}
+
+static struct process *prio_steal(struct cpu *cpu)
+{
+	struct process *p = prio_array_peek_tail(&cpu->prio_array);
+
+	if (p) {
+		prio_array_dequeue(&cpu->prio_array, p);
+	}
+	return p;
+}
+
+static void prio_enqueue(struct cpu *cpu, struct process *p)
+{
+	prio_array_enqueue(&cpu->prio_array, p);
+}
+
+struct scheduler prio_scheduler = {
+	.name = "Priority",
+	.acquire = prio_acquire,
+	.release = prio_release,
+	.initialize = prio_initialize,
+	.schedule = prio_schedule,
+	.timeslice = prio_timeslice,
+	.nr_ready = prio_nr_ready,
+	.steal = prio_steal,
+	.enqueue = prio_enqueue,
+	.forked = preemptive_prio,
 
 	/**
 	 * Implement your own acqure/release function to make priority
@@ -540,104 +935,347 @@ struct scheduler prio_scheduler = {
 };
 
 
+/***********************************************************************
+ * Multi-level feedback queue scheduler
+ ***********************************************************************/
+
+/**
+ * Processes start at the top level, level 0, and sink by one level each
+ * time they use up the quantum of their level. The quantum counts the ticks
+ * run at the level across the resource waits so that processes cannot stay
+ * on top by blocking just before it expires. The processes at the bottom
+ * level take turns with its quantum, and every @sim->mlfq_boost ticks all
+ * processes go back to the top level.
+ *
+ * The levels are laid on @cpu->prio_array upside down so that the top level
+ * is found with the bitmap. @cpu->epoch counts the boosts, and a process
+ * whose @mlfq_epoch is behind it has been boosted since it got its level.
+ */
+static int mlfq_array_level(struct sim *sim, unsigned int level)
+{
+	return sim->mlfq_levels - 1 - level;
+}
+
+static unsigned int mlfq_level_of(struct cpu *cpu, struct process *p)
+{
+	return cpu->sim->mlfq_levels - 1 - prio_array_level(&cpu->prio_array, p);
+}
+
+static long long mlfq_epoch(struct sim *sim)
+{
+	return sim->mlfq_boost ? sim->ticks / sim->mlfq_boost : 0;
+}
+
+static void mlfq_set_level(struct cpu *cpu, struct process *p, unsigned int level)
+{
+	p->mlfq_level = level;
+	p->mlfq_epoch = cpu->epoch;
+	p->slice_start = p->age;
+}
+
+static void mlfq_refresh(struct cpu *cpu, struct process *p)
+{
+	if (p->mlfq_epoch != cpu->epoch) {
+		mlfq_set_level(cpu, p, 0);
+	}
+}
+
+static void mlfq_enqueue(struct cpu *cpu, struct process *p)
+{
+	mlfq_refresh(cpu, p);
+	prio_array_enqueue_level(&cpu->prio_array, p,
+			mlfq_array_level(cpu->sim, p->mlfq_level));
+}
+
+/**
+ * Merge the lower levels onto the top level keeping the queued processes in
+ * the order they would have been served. They are refreshed as they leave
+ * the queue, like the others are as they get queued
+ */
+static void mlfq_boost(struct cpu *cpu)
+{
+	cpu->epoch = mlfq_epoch(cpu->sim);
+	prio_array_merge(&cpu->prio_array, mlfq_array_level(cpu->sim, 0));
+}
+
+static int mlfq_initialize(struct cpu *cpu)
+{
+	prio_array_init(&cpu->prio_array);
+	cpu->epoch = 0;
+	return 0;
+}
+
+static struct process *mlfq_schedule(struct cpu *cpu)
+{
+	struct sim *sim = cpu->sim;
+	struct process *curr = cpu->current;
+	struct process *next;
+	unsigned int used, quantum;
+	bool bottom;
+
+	if (cpu->epoch != mlfq_epoch(sim)) mlfq_boost(cpu);
+
+	if (!curr || curr->status == PROCESS_WAIT || curr->age >= curr->lifespan) {
+		goto pick_next;
+	}
+
+	mlfq_refresh(cpu, curr);
+	used = curr->age - curr->slice_start;
+	quantum = sim->mlfq_quanta[curr->mlfq_level];
+	bottom = curr->mlfq_level == sim->mlfq_levels - 1;
+
+	/**
+	 * A process alone at the bottom gets a new slice whenever one expires.
+	 * Roll them forward if the ticks have been skipped meanwhile
+	 */
+	if (bottom && used > quantum) {
+		curr->slice_start += (used - 1) / quantum * quantum;
+		used = curr->age - curr->slice_start;
+	}
+
+	next = prio_array_peek(&cpu->prio_array);
+
+	if (used < quantum) {
+		/* Keep running unless someone at a higher level shows up */
+		if (!next || mlfq_level_of(cpu, next) >= curr->mlfq_level) {
+			return curr;
+		}
+	} else {
+		/* Used up the quantum. Sink to the next level */
+		mlfq_set_level(cpu, curr, bottom ? curr->mlfq_level : curr->mlfq_level + 1);
+	}
+	mlfq_enqueue(cpu, curr);
+
+pick_next:
+	next = prio_array_peek(&cpu->prio_array);
+	if (next) {
+		prio_array_dequeue(&cpu->prio_array, next);
+		mlfq_refresh(cpu, next);
+	}
+	return next;
+}
+
+static void mlfq_forked(struct cpu *cpu, struct process *p)
+{
+	/* Take the newly forked process from @readyqueue to the top level */
+	list_del_init(&p->list);
+
+	mlfq_set_level(cpu, p, 0);
+	mlfq_enqueue(cpu, p);
+}
+
+/**
+ * Same as fcfs_release() except that the waiter goes back to its level
+ */
+static void mlfq_release(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct process *waiter;
+	struct wakeup wakeup = resource_put(r, cpu->current);
+
+	while ((waiter = fcfs_wake_up(cpu->sim, r, &wakeup))) {
+		waiter->status = PROCESS_READY;
+		mlfq_enqueue(waiter->cpu, waiter);
+	}
+}
+
+static struct process *mlfq_steal(struct cpu *cpu)
+{
+	struct process *p = prio_steal(cpu);
+
+	/* Take the boost along in case @p has been merged up */
+	if (p) {
+		mlfq_refresh(cpu, p);
+	}
+	return p;
+}
+
+static unsigned int mlfq_timeslice(struct cpu *cpu)
+{
+	struct sim *sim = cpu->sim;
+	struct process *curr = cpu->current;
+	struct process *next = prio_array_peek(&cpu->prio_array);
+	unsigned int used = curr->age - curr->slice_start;
+	unsigned int quantum = sim->mlfq_quanta[curr->mlfq_level];
+	unsigned int nr_ticks;
+
+	if (next && mlfq_level_of(cpu, next) < curr->mlfq_level) return 0;
+
+	if (!next && curr->mlfq_level == sim->mlfq_levels - 1) {
+		nr_ticks = UINT_MAX;
+	} else {
+		nr_ticks = used < quantum ? quantum - used : 0;
+	}
+
+	/* Everyone gets boosted at the next epoch */
+	if (sim->mlfq_boost) {
+		unsigned long long until = (cpu->epoch + 1) * sim->mlfq_boost - sim->ticks;
+		if (until < nr_ticks) nr_ticks = until;
+	}
+	return nr_ticks;
+}
+
+struct scheduler mlfq_scheduler = {
+	.name = "Multi-Level Feedback Queue",
+	.acquire = fcfs_acquire,
+	.release = mlfq_release,
+	.initialize = mlfq_initialize,
+	.forked = mlfq_forked,
+	.schedule = mlfq_schedule,
+	.timeslice = mlfq_timeslice,
+	.nr_ready = prio_nr_ready,
+	.steal = mlfq_steal,
+	.enqueue = mlfq_enqueue,
+};
+
+
 /***********************************************************************
  * Priority scheduler with aging
  ***********************************************************************/
-static struct process *pa_schedule(void)
+
+/**
+ * Ready processes are aged lazily. Instead of boosting every ready process
+ * on each scheduling, @cpu->epoch counts the boosts so far, and a process
+ * enqueued with priority P at epoch E has the effective priority
+ * P + (@cpu->epoch - E). All ready processes on @cpu->heap get boosted
+ * together, so their order by E - P never changes and the heap stays valid
+ * as time goes by.
+ */
+static unsigned int pa_effective_prio(struct cpu *cpu, struct process *p)
+{
+	return cpu->epoch - p->rq_key;
+}
+
+static void pa_enqueue(struct cpu *cpu, struct process *p)
+{
+	heap_rq_enqueue(cpu, p, cpu->epoch - (long long)p->prio);
+}
+
+static void pa_dequeue(struct cpu *cpu, struct process *p)
+{
+	p->prio = pa_effective_prio(cpu, p);
+	heap_rq_dequeue(&cpu->heap, p);
+}
+
+static int pa_initialize(struct cpu *cpu)
+{
+	heap_init(&cpu->heap, heap_rq_less);
+	cpu->epoch = 0;
+	return 0;
+}
+
+static void pa_finalize(struct cpu *cpu)
+{
+	heap_destroy(&cpu->heap);
+}
+
+static struct process *pa_schedule(struct cpu *cpu)
 {
 	struct process *next = NULL;
 
 
-	if(current){
-		current->prio = current->prio_orig;
-		if(!list_empty(&readyqueue))
-        	{
-                	struct process *p;
-        	        list_for_each_entry(p, &readyqueue, list){
-                       		p->prio++;
-                	}
-        	}
+	if(cpu->current){
+		cpu->current->prio = cpu->current->prio_orig;
+		cpu->epoch++;
 	}
 	//fprintf(stderr,"tick:%d\n",ticks);
-	//dump_status();
+	//dump_status(cpu->sim);
 
-	if(!current || current->status == PROCESS_WAIT){
+	if(!cpu->current || cpu->current->status == PROCESS_WAIT){
 		goto pick_next;
 	}
 
-	if(current->age < current->lifespan){
+	if(cpu->current->age < cpu->current->lifespan){
 		
-		struct process *tmp;
-		unsigned int max = 0;
-		bool check2 = false;
-		list_for_each_entry(tmp, &readyqueue, list){
-			if(tmp->prio > max){
-				max = tmp->prio;
-				next = tmp;
-				check2 = true;
-			}
-			if(tmp->prio == 0 && check2 == false)
-			{
-				next = tmp;
-				max = tmp->prio;
-				check2 = true;
-			}
-		}
-		if (max == current->prio && !list_empty(&readyqueue))
+		unsigned int max;
+
+		next = heap_rq_peek(&cpu->heap);
+		max = next ? pa_effective_prio(cpu, next) : 0;
+
+		if (max == cpu->current->prio && next)
 		{
-			current->status = PROCESS_WAIT;
-			list_move_tail(&current->list, &readyqueue);
+			cpu->current->status = PROCESS_WAIT;
+			pa_enqueue(cpu, cpu->current);
 
-			list_del_init(&next->list);
+			pa_dequeue(cpu, next);
 			
 			return next;
 		}
-		if(current->prio < max)
+		if(cpu->current->prio < max)
 		{
-			current->status = PROCESS_WAIT;
-			list_move_tail(&current->list, &readyqueue);
+			cpu->current->status = PROCESS_WAIT;
+			pa_enqueue(cpu, cpu->current);
 
-			list_del_init(&next->list);
+			pa_dequeue(cpu, next);
 			
 			return next;
 		}
-		return current;
+		return cpu->current;
 	}
 	
 pick_next :
-	if(!list_empty(&readyqueue)){
-		struct process *p;
-		bool check = false;
-		unsigned int max_prio = 0;
-		list_for_each_entry(p, &readyqueue, list){
-			if(p->prio > max_prio)
-			{	
-				next = p;
-				max_prio = p->prio;
-				check = true;
-			}
-			if(p->prio == 0 && check == false)
-			{
-				next = p;
-				max_prio = p->prio;
-				check = true;
-			}
-		}
-		//if(current){
-		//	if(current->prio > next->prio)
-		//		return current;
-		//}
-		list_del_init(&next->list);
-		return next;
+	next = heap_rq_peek(&cpu->heap);
+	if(next){
+		pa_dequeue(cpu, next);
 	}
 	return next;
 
 }
 
+static void pa_forked(struct cpu *cpu, struct process *p)
+{
+	/* Take the newly forked process from @readyqueue to the aging heap */
+	list_del_init(&p->list);
+
+	if (cpu->current && p->prio > cpu->current->prio && !cpu->current->blocked) {
+		cpu->current->status = PROCESS_WAIT;
+		list_del_init(&cpu->current->list);
+		pa_enqueue(cpu, cpu->current);
+
+		cpu->current = p;
+		return;
+	}
+	pa_enqueue(cpu, p);
+}
+
+static unsigned int pa_timeslice(struct cpu *cpu)
+{
+	/**
+	 * Waiting processes get boosted on every tick, and the boost given to
+	 * the current is taken back on the next schedule
+	 */
+	if (!heap_empty(&cpu->heap) || cpu->current->prio != cpu->current->prio_orig) {
+		return 1;
+	}
+	return UINT_MAX;
+}
+
+static unsigned int pa_nr_ready(struct cpu *cpu)
+{
+	return cpu->heap.nr_nodes;
+}
+
+static struct process *pa_steal(struct cpu *cpu)
+{
+	struct process *p = heap_rq_peek_last(&cpu->heap);
+
+	/* The process carries the boost it got so far to the new CPU */
+	if (p) {
+		pa_dequeue(cpu, p);
+	}
+	return p;
+}
+
 struct scheduler pa_scheduler = {
 	.name = "Priority + aging",
-	.forked = preemptive_prio,
+	.initialize = pa_initialize,
+	.finalize = pa_finalize,
+	.forked = pa_forked,
 	.schedule = pa_schedule,
+	.timeslice = pa_timeslice,
+	.nr_ready = pa_nr_ready,
+	.steal = pa_steal,
+	.enqueue = pa_enqueue,
 	/**
 	 * Implement your own acqure/release function to make priority
 	 * scheduler correct.
@@ -650,60 +1288,79 @@ struct scheduler pa_scheduler = {
  * Priority scheduler with priority ceiling protocol
  ***********************************************************************/
 
-bool PCP_acquire(int resource_id)
+/**
+ * An owner runs at the highest ceiling of the resources it holds. The
+ * ceilings are worked out as the script is loaded, and the holder keeps
+ * the resources on a stack in the acquiring order, each with the highest
+ * ceiling up to it, so both the acquire and the nested release are O(1).
+ * Multi-unit resources and those held in the shared mode have no owner to
+ * raise, so the scheduler is declared with .ceilings and sim_run() refuses
+ * the scripts acquiring them
+ */
+static unsigned int pcp_stack_ceiling(struct process *p)
 {
-	struct resource *r = resources + resource_id;
+	if (list_empty(&p->ceilings)) return p->prio_orig;
+
+	return list_first_entry(&p->ceilings, struct resource, ceiling_list)->stack_ceiling;
+}
+
+/**
+ * Work the stack ceilings out again from the bottom after a resource in
+ * the middle is released out of the acquiring order
+ */
+static void pcp_restack(struct process *p)
+{
+	struct resource *r;
+	unsigned int ceiling = p->prio_orig;
+
+	list_for_each_entry_reverse(r, &p->ceilings, ceiling_list) {
+		if (r->ceiling > ceiling) ceiling = r->ceiling;
+		r->stack_ceiling = ceiling;
+	}
+}
+
+bool PCP_acquire(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+
+	if (resource_available(cpu->sim, r, cpu->current)) {
+		unsigned int ceiling = pcp_stack_ceiling(cpu->current);
+
+		resource_get(cpu->sim, r, cpu->current);
+		if (!r->owner) return true;
 
-	if(!r->owner){
-		r->owner = current;
 		//celling
-		r->owner->prio = MAX_PRIO;
+		r->stack_ceiling = r->ceiling > ceiling ? r->ceiling : ceiling;
+		list_add(&r->ceiling_list, &r->owner->ceilings);
+		r->owner->prio = r->stack_ceiling;
 		return true;
 	}
 
-	current->status = PROCESS_WAIT;
+	cpu->current->status = PROCESS_WAIT;
 	
-	mark[current->pid] = 1;
-	list_add_tail(&current->list, &r->waitqueue);
+	cpu->current->blocked = true;
+	prio_wait(r, cpu->current);
 
 	return false;
 }
 
-void PCP_release(int resource_id)
+void PCP_release(struct cpu *cpu, int resource_id)
 {
-	struct resource *r = resources + resource_id;
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct wakeup wakeup;
 
-	assert(r->owner == current);
-	
-	//fprintf(stderr,"%d %d\n",current->prio, current->prio_orig);
-	current->prio = current->prio_orig;
-	change[current->pid] = 1;
-
-	r->owner = NULL;
+	if (r->owner) {
+		bool nested = cpu->current->ceilings.next == &r->ceiling_list;
 
-	if(!list_empty(&r->waitqueue)){
+		list_del_init(&r->ceiling_list);
+		if (!nested) pcp_restack(cpu->current);
 
-		unsigned int max_prio = 0;
-		struct process *waiter, *max_waiter;
-	       
-		list_for_each_entry(waiter, &r->waitqueue, list){
-			if(max_prio < waiter->prio)
-			{
-				max_prio = waiter->prio;
-				max_waiter = waiter;
-			}
-		}
-		assert(max_waiter->status == PROCESS_WAIT);
-		
-		mark[max_waiter->pid] = 0;
-		list_del_init(&max_waiter->list);
-		max_waiter->status = PROCESS_READY;
-		list_add_tail(&max_waiter->list, &readyqueue);
-	
-		
+		cpu->current->prio = pcp_stack_ceiling(cpu->current);
 	}
+	cpu->current->prio_dropped = true;
 
-
+	wakeup = resource_put(r, cpu->current);
+	prio_wake_up_all(cpu->sim, r, wakeup);
 }
 
 
@@ -711,8 +1368,14 @@ struct scheduler pcp_scheduler = {
 	.name = "Priority + PCP Protocol",
 	.acquire = PCP_acquire,
 	.release = PCP_release,
+	.initialize = prio_initialize,
 	.schedule = prio_schedule,
+	.timeslice = prio_timeslice,
+	.nr_ready = prio_nr_ready,
+	.steal = prio_steal,
+	.enqueue = prio_enqueue,
 	.forked = preemptive_prio,
+	.ceilings = true,
 	/**
 	 * Implement your own acqure/release function too to make priority
 	 * scheduler correct.
@@ -723,36 +1386,688 @@ struct scheduler pcp_scheduler = {
 /***********************************************************************
  * Priority scheduler with priority inheritance protocol
  ***********************************************************************/
-bool PIP_acquire(int resource_id)
+/**
+ * Every resource held with waiters donates the priority of its top waiter
+ * to the owner through @owner->donations, so the owner runs at the highest
+ * of its original priority and the donations. An owner waiting for another
+ * resource passes the boost on to the owner of that one, and so on along
+ * the chain of the blocked owners. Multi-unit resources and those held in
+ * the shared mode have no owner to donate to.
+ */
+static unsigned int pip_prio(struct process *p)
+{
+	struct heap_node *node = heap_peek(&p->donations);
+	struct process *waiter;
+
+	if (!node) return p->prio_orig;
+
+	waiter = prio_top_waiter(container_of(node, struct resource, donation));
+
+	return waiter->prio > p->prio_orig ? waiter->prio : p->prio_orig;
+}
+
+/**
+ * Reflect the change of the waiters of @r to its owner, and follow the
+ * chain while the priority of the owners changes. The chain is walked in
+ * a loop rather than recursively as it can be as deep as the processes
+ */
+static void pip_propagate(struct resource *r)
 {
-	struct resource *r = resources + resource_id;
+	while (r && r->owner) {
+		struct process *owner = r->owner;
+		unsigned int prio;
+
+		if (!prio_top_waiter(r)) {
+			if (heap_queued(&r->donation)) heap_remove(&owner->donations, &r->donation);
+		} else if (heap_queued(&r->donation)) {
+			heap_update(&owner->donations, &r->donation);
+		} else {
+			heap_push(&owner->donations, &r->donation);
+		}
+
+		prio = pip_prio(owner);
+		if (prio == owner->prio) break;
+		owner->prio = prio;
 
-	if(!r->owner){
-		//fprintf(stderr,"%d %d\n",current->prio, current->prio_orig);
-		r->owner = current;
+		if (prio_array_queued(owner)) {
+			prio_array_requeue(&owner->cpu->prio_array, owner);
+		}
+
+		r = owner->waiting_for;
+		if (r) heap_update(prio_waiters(r, owner), &owner->rq_node);
+	}
+}
+
+bool PIP_acquire(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+
+	if (resource_available(cpu->sim, r, cpu->current)) {
+		resource_get(cpu->sim, r, cpu->current);
+
+		/* The waiters left behind by the last owner donate to the new one */
+		if (prio_top_waiter(r)) pip_propagate(r);
 		return true;
 	}
 
-	current->status = PROCESS_WAIT;
+	cpu->current->status = PROCESS_WAIT;
+
+	cpu->current->blocked = true;
+	prio_wait(r, cpu->current);
 
-	list_add_tail(&current->list, &r->waitqueue);
-	
-	//fprintf(stderr,"%d %d \n",current->prio, current->prio_orig);
-	
 	//inheritance
-	r->owner->prio = current->prio;
+	pip_propagate(r);
 
 	return false;
 }
 
+void PIP_release(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct wakeup wakeup;
+
+	/* Take back the donation of @r and fall to the next one in O(log n) */
+	if (heap_queued(&r->donation)) {
+		heap_remove(&cpu->current->donations, &r->donation);
+	}
+	cpu->current->prio = pip_prio(cpu->current);
+	cpu->current->prio_dropped = true;
+
+	wakeup = resource_put(r, cpu->current);
+	prio_wake_up_all(cpu->sim, r, wakeup);
+}
+
 
 struct scheduler pip_scheduler = {
 	.name = "Priority + PIP Protocol",
+	.initialize = prio_initialize,
 	.schedule = prio_schedule,
+	.timeslice = prio_timeslice,
+	.nr_ready = prio_nr_ready,
+	.steal = prio_steal,
+	.enqueue = prio_enqueue,
 	.forked = preemptive_prio,
 	.acquire = PIP_acquire,
-	.release = PCP_release,
+	.release = PIP_release,
 	/**
 	 * Ditto
 	 */
 };
+
+
+/***********************************************************************
+ * Completely fair scheduler
+ ***********************************************************************/
+
+/**
+ * Each process accumulates virtual runtime as it runs, and the process with
+ * the smallest one runs next. A process of priority P weighs P + 1, and its
+ * virtual runtime grows by FAIR_SCALE / (P + 1) per tick, so the CPU time is
+ * shared in proportion to the weights. A process with the default priority
+ * gains FAIR_SCALE per tick.
+ *
+ * The ready processes are kept on @cpu->heap keyed by their virtual runtime.
+ * @vruntime of the current is brought up to date only when it gets off the
+ * CPU; in the meantime it is @vruntime plus the ticks run since @slice_start.
+ */
+#define FAIR_SCALE	(1LL << 20)
+
+static long long fair_delta(struct process *p)
+{
+	return FAIR_SCALE / ((long long)p->prio + 1);
+}
+
+static long long fair_vruntime(struct process *p)
+{
+	return p->vruntime + (long long)(p->age - p->slice_start) * fair_delta(p);
+}
+
+static void fair_put(struct cpu *cpu, struct process *p)
+{
+	p->vruntime = fair_vruntime(p);
+	p->slice_start = p->age;
+	heap_rq_enqueue(cpu, p, p->vruntime);
+}
+
+static struct process *fair_pick(struct cpu *cpu)
+{
+	struct process *next = heap_rq_peek(&cpu->heap);
+
+	if (next) {
+		heap_rq_dequeue(&cpu->heap, next);
+		next->slice_start = next->age;
+	}
+	return next;
+}
+
+/**
+ * @cpu->min_vruntime follows the smallest virtual runtime of the runnable
+ * processes on @cpu but never goes back. The newcomers start from there so
+ * that they neither starve the others nor get starved. It is brought up to
+ * date before the heap changes, so it comes out the same no matter how
+ * often schedule() is called
+ */
+static void fair_update_min_vruntime(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *left = heap_rq_peek(&cpu->heap);
+	long long min = LLONG_MAX;
+
+	if (curr && curr->status != PROCESS_WAIT && curr->age < curr->lifespan) {
+		min = fair_vruntime(curr);
+	}
+	if (left && left->rq_key < min) min = left->rq_key;
+
+	if (min != LLONG_MAX && min > cpu->min_vruntime) cpu->min_vruntime = min;
+}
+
+static int fair_initialize(struct cpu *cpu)
+{
+	heap_init(&cpu->heap, heap_rq_less);
+	cpu->min_vruntime = 0;
+	return 0;
+}
+
+static void fair_finalize(struct cpu *cpu)
+{
+	heap_destroy(&cpu->heap);
+}
+
+static struct process *fair_schedule(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *left;
+
+	fair_update_min_vruntime(cpu);
+
+	if (!curr) goto pick_next;
+
+	if (curr->status == PROCESS_WAIT) {
+		/* Blocked. Account the ticks it ran until it gets woken up */
+		curr->vruntime = fair_vruntime(curr);
+		curr->slice_start = curr->age;
+		goto pick_next;
+	}
+
+	if (curr->age >= curr->lifespan) goto pick_next;
+
+	/**
+	 * Keep running for the minimum granularity, and then until someone
+	 * falls behind in the virtual runtime
+	 */
+	left = heap_rq_peek(&cpu->heap);
+	if (!left || curr->age - curr->slice_start < cpu->sim->min_granularity ||
+			fair_vruntime(curr) <= left->rq_key) {
+		return curr;
+	}
+	fair_put(cpu, curr);
+
+pick_next:
+	return fair_pick(cpu);
+}
+
+static void fair_forked(struct cpu *cpu, struct process *p)
+{
+	/* Take the newly forked process from @readyqueue to the heap */
+	list_del_init(&p->list);
+
+	fair_update_min_vruntime(cpu);
+	p->vruntime = cpu->min_vruntime;
+	p->slice_start = p->age;
+	heap_rq_enqueue(cpu, p, p->vruntime);
+}
+
+/**
+ * Same as fcfs_release() except that the waiter goes onto the heap of its
+ * CPU. A process coming back from a wait is placed up to @sleeper_credit
+ * ticks behind @min_vruntime so that it runs soon, but it does not bring
+ * back all the time it spent sleeping
+ */
+static void fair_release(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct process *waiter;
+	struct wakeup wakeup = resource_put(r, cpu->current);
+
+	while ((waiter = fcfs_wake_up(cpu->sim, r, &wakeup))) {
+		long long floor;
+
+		fair_update_min_vruntime(waiter->cpu);
+
+		waiter->status = PROCESS_READY;
+
+		/* It might get blocked and woken up before being scheduled out */
+		waiter->vruntime = fair_vruntime(waiter);
+		waiter->slice_start = waiter->age;
+
+		floor = waiter->cpu->min_vruntime - (long long)cpu->sim->sleeper_credit * FAIR_SCALE;
+		if (waiter->vruntime < floor) waiter->vruntime = floor;
+
+		heap_rq_enqueue(waiter->cpu, waiter, waiter->vruntime);
+	}
+}
+
+static unsigned int fair_timeslice(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *left = heap_rq_peek(&cpu->heap);
+	unsigned int ran = curr->age - curr->slice_start;
+	long long gap;
+	unsigned long long until;
+
+	if (!left) return UINT_MAX;
+
+	/* The first tick at which @curr gets ahead of @left */
+	gap = left->rq_key - curr->vruntime;
+	until = gap < 0 ? 0 : gap / fair_delta(curr) + 1;
+
+	if (until < cpu->sim->min_granularity) until = cpu->sim->min_granularity;
+	if (until <= ran) return 0;
+	return until - ran > UINT_MAX ? UINT_MAX : until - ran;
+}
+
+static unsigned int fair_nr_ready(struct cpu *cpu)
+{
+	return cpu->heap.nr_nodes;
+}
+
+/**
+ * Virtual runtimes are meaningful only against the @min_vruntime of the
+ * CPU. A migrating process carries its lag behind the source CPU over to
+ * the destination CPU
+ */
+static struct process *fair_steal(struct cpu *cpu)
+{
+	struct process *p = heap_rq_peek_last(&cpu->heap);
+
+	fair_update_min_vruntime(cpu);
+	if (p) {
+		heap_rq_dequeue(&cpu->heap, p);
+		p->vruntime -= cpu->min_vruntime;
+	}
+	return p;
+}
+
+static void fair_enqueue(struct cpu *cpu, struct process *p)
+{
+	fair_update_min_vruntime(cpu);
+	p->vruntime += cpu->min_vruntime;
+	heap_rq_enqueue(cpu, p, p->vruntime);
+}
+
+struct scheduler fair_scheduler = {
+	.name = "Completely Fair",
+	.acquire = fcfs_acquire,
+	.release = fair_release,
+	.initialize = fair_initialize,
+	.finalize = fair_finalize,
+	.forked = fair_forked,
+	.schedule = fair_schedule,
+	.timeslice = fair_timeslice,
+	.nr_ready = fair_nr_ready,
+	.steal = fair_steal,
+	.enqueue = fair_enqueue,
+};
+
+
+/***********************************************************************
+ * Proportional-share schedulers
+ ***********************************************************************/
+
+/**
+ * A process holds @prio + 1 tickets, and deserves the share of a CPU in
+ * proportion to its tickets among the runnable processes on the CPU. A
+ * ticket deserves 1 / @cpu->nr_tickets of each tick, which is accumulated
+ * in @cpu->global_pass scaled by STRIDE1. The share a process deserves
+ * while it is runnable on a CPU is then its tickets times the progress
+ * of @global_pass in the meantime, and it is added up in @entitled.
+ */
+#define STRIDE1		(1LL << 20)
+
+static unsigned int share_tickets(struct process *p)
+{
+	return p->prio + 1;
+}
+
+static void share_advance(struct cpu *cpu)
+{
+	unsigned int now = cpu->sim->ticks;
+
+	if (cpu->nr_tickets) {
+		cpu->global_pass += (long long)(now - cpu->global_pass_at) * STRIDE1 / cpu->nr_tickets;
+	}
+	cpu->global_pass_at = now;
+}
+
+static void share_join(struct cpu *cpu, struct process *p)
+{
+	share_advance(cpu);
+	p->share_joined = cpu->global_pass;
+	cpu->nr_tickets += share_tickets(p);
+}
+
+static void share_leave(struct cpu *cpu, struct process *p)
+{
+	share_advance(cpu);
+	p->entitled += (double)share_tickets(p) * (cpu->global_pass - p->share_joined) / STRIDE1;
+	cpu->nr_tickets -= share_tickets(p);
+}
+
+static int share_initialize(struct cpu *cpu)
+{
+	cpu->global_pass = 0;
+	cpu->global_pass_at = cpu->sim->ticks;
+	cpu->nr_tickets = 0;
+	return 0;
+}
+
+/**
+ * Same as fcfs_acquire() except that a blocked process gives up its share
+ */
+static bool share_acquire(struct cpu *cpu, int resource_id)
+{
+	if (fcfs_acquire(cpu, resource_id)) return true;
+
+	share_leave(cpu, cpu->current);
+	return false;
+}
+
+/**
+ * Same as fcfs_wake_up() except that the waiter claims its share, and is
+ * left for the caller to put into the runqueue of its CPU
+ */
+static struct process *share_wake_up(struct cpu *cpu, struct resource *r, struct wakeup *wakeup)
+{
+	struct process *waiter = fcfs_wake_up(cpu->sim, r, wakeup);
+
+	if (!waiter) return NULL;
+
+	waiter->status = PROCESS_READY;
+	share_join(waiter->cpu, waiter);
+	return waiter;
+}
+
+static void share_exiting(struct cpu *cpu, struct process *p)
+{
+	share_leave(cpu, p);
+}
+
+
+/***********************************************************************
+ * Stride scheduler
+ ***********************************************************************/
+
+/**
+ * Each process advances its pass by its stride, STRIDE1 / tickets, per
+ * tick it runs, and the process with the smallest pass runs next. The ready
+ * processes are kept on @cpu->heap keyed by the pass. As the fair scheduler
+ * does, the pass of the current is brought up to date only when it gets
+ * off the CPU.
+ *
+ * A process leaving a CPU keeps the pass it is left to go relative to
+ * @cpu->global_pass, and it resumes with the same distance on joining so
+ * that neither sleeping nor migrating is rewarded or penalized. A new
+ * process starts a stride ahead of @global_pass.
+ */
+static long long stride_of(struct process *p)
+{
+	return STRIDE1 / share_tickets(p);
+}
+
+static long long stride_pass(struct process *p)
+{
+	return p->pass + (long long)(p->age - p->slice_start) * stride_of(p);
+}
+
+static void stride_commit(struct process *p)
+{
+	p->pass = stride_pass(p);
+	p->slice_start = p->age;
+}
+
+static void stride_join(struct cpu *cpu, struct process *p)
+{
+	share_join(cpu, p);
+	p->pass += cpu->global_pass;
+	heap_rq_enqueue(cpu, p, p->pass);
+}
+
+static int stride_initialize(struct cpu *cpu)
+{
+	heap_init(&cpu->heap, heap_rq_less);
+	return share_initialize(cpu);
+}
+
+static void stride_finalize(struct cpu *cpu)
+{
+	heap_destroy(&cpu->heap);
+}
+
+static struct process *stride_schedule(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *next;
+
+	/* Blocked processes have been taken care of on acquire() */
+	if (!curr || curr->status == PROCESS_WAIT || curr->age >= curr->lifespan) {
+		goto pick_next;
+	}
+
+	next = heap_rq_peek(&cpu->heap);
+	if (!next || stride_pass(curr) <= next->rq_key) {
+		return curr;
+	}
+	stride_commit(curr);
+	heap_rq_enqueue(cpu, curr, curr->pass);
+
+pick_next:
+	next = heap_rq_peek(&cpu->heap);
+	if (next) {
+		heap_rq_dequeue(&cpu->heap, next);
+		next->slice_start = next->age;
+	}
+	return next;
+}
+
+static void stride_forked(struct cpu *cpu, struct process *p)
+{
+	/* Take the newly forked process from @readyqueue to the heap */
+	list_del_init(&p->list);
+
+	p->pass = stride_of(p);
+	p->slice_start = p->age;
+	stride_join(cpu, p);
+}
+
+static bool stride_acquire(struct cpu *cpu, int resource_id)
+{
+	struct process *curr = cpu->current;
+
+	if (share_acquire(cpu, resource_id)) return true;
+
+	stride_commit(curr);
+	curr->pass -= cpu->global_pass;
+	return false;
+}
+
+static void stride_release(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct process *waiter;
+	struct wakeup wakeup = resource_put(r, cpu->current);
+
+	while ((waiter = share_wake_up(cpu, r, &wakeup))) {
+		waiter->pass += waiter->cpu->global_pass;
+		heap_rq_enqueue(waiter->cpu, waiter, waiter->pass);
+	}
+}
+
+static unsigned int stride_timeslice(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *next = heap_rq_peek(&cpu->heap);
+	unsigned int ran = curr->age - curr->slice_start;
+	long long gap;
+	unsigned long long until;
+
+	if (!next) return UINT_MAX;
+
+	/* The first tick at which @curr passes @next */
+	gap = next->rq_key - curr->pass;
+	until = gap < 0 ? 0 : gap / stride_of(curr) + 1;
+
+	if (until <= ran) return 0;
+	return until - ran > UINT_MAX ? UINT_MAX : until - ran;
+}
+
+static unsigned int stride_nr_ready(struct cpu *cpu)
+{
+	return cpu->heap.nr_nodes;
+}
+
+static struct process *stride_steal(struct cpu *cpu)
+{
+	struct process *p = heap_rq_peek_last(&cpu->heap);
+
+	if (p) {
+		heap_rq_dequeue(&cpu->heap, p);
+		share_leave(cpu, p);
+		p->pass -= cpu->global_pass;
+	}
+	return p;
+}
+
+struct scheduler stride_scheduler = {
+	.name = "Stride",
+	.acquire = stride_acquire,
+	.release = stride_release,
+	.initialize = stride_initialize,
+	.finalize = stride_finalize,
+	.forked = stride_forked,
+	.exiting = share_exiting,
+	.schedule = stride_schedule,
+	.timeslice = stride_timeslice,
+	.nr_ready = stride_nr_ready,
+	.steal = stride_steal,
+	.enqueue = stride_join,
+};
+
+
+/***********************************************************************
+ * Lottery scheduler
+ ***********************************************************************/
+
+/**
+ * Every tick a ticket is drawn among the runnable processes on the CPU,
+ * and its holder runs. The ready processes stay in @cpu->readyqueue, and
+ * the draw walks them with the current. Each CPU draws from its own
+ * random sequence, so a simulation is reproducible.
+ */
+static unsigned long long lottery_random(struct cpu *cpu)
+{
+	unsigned long long x = cpu->lottery_seed;
+
+	/* xorshift64* */
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	cpu->lottery_seed = x;
+	return x * 2685821657736338717ULL;
+}
+
+static int lottery_initialize(struct cpu *cpu)
+{
+	cpu->lottery_seed = 0x9e3779b97f4a7c15ULL * (cpu->id + 1);
+	return share_initialize(cpu);
+}
+
+static struct process *lottery_schedule(struct cpu *cpu)
+{
+	struct process *curr = cpu->current;
+	struct process *p, *next = NULL;
+	unsigned long long total = cpu->nr_tickets;
+	unsigned long long winner;
+	bool runnable = curr && curr->status != PROCESS_WAIT;
+
+	/* The exiting current still holds its tickets until exiting() */
+	if (runnable && curr->age >= curr->lifespan) {
+		total -= share_tickets(curr);
+		runnable = false;
+	}
+
+	if (list_empty(&cpu->readyqueue)) {
+		return runnable ? curr : NULL;
+	}
+
+	winner = lottery_random(cpu) % total;
+
+	if (runnable) {
+		if (winner < share_tickets(curr)) return curr;
+		winner -= share_tickets(curr);
+	}
+
+	list_for_each_entry(p, &cpu->readyqueue, list) {
+		if (winner < share_tickets(p)) {
+			next = p;
+			break;
+		}
+		winner -= share_tickets(p);
+	}
+	assert(next);
+
+	list_del_init(&next->list);
+	if (runnable) {
+		list_add_tail(&curr->list, &cpu->readyqueue);
+	}
+	return next;
+}
+
+static void lottery_forked(struct cpu *cpu, struct process *p)
+{
+	share_join(cpu, p);
+}
+
+static void lottery_release(struct cpu *cpu, int resource_id)
+{
+	struct resource *r = cpu->sim->resources + resource_id;
+	struct process *waiter;
+	struct wakeup wakeup = resource_put(r, cpu->current);
+
+	while ((waiter = share_wake_up(cpu, r, &wakeup))) {
+		list_add_tail(&waiter->list, &waiter->cpu->readyqueue);
+	}
+}
+
+static unsigned int lottery_timeslice(struct cpu *cpu)
+{
+	/* Draw on every tick while someone else is waiting */
+	return list_empty(&cpu->readyqueue) ? UINT_MAX : 1;
+}
+
+static struct process *lottery_steal(struct cpu *cpu)
+{
+	struct process *p = fcfs_steal(cpu);
+
+	if (p) share_leave(cpu, p);
+	return p;
+}
+
+static void lottery_enqueue(struct cpu *cpu, struct process *p)
+{
+	share_join(cpu, p);
+	fcfs_enqueue(cpu, p);
+}
+
+struct scheduler lottery_scheduler = {
+	.name = "Lottery",
+	.acquire = share_acquire,
+	.release = lottery_release,
+	.initialize = lottery_initialize,
+	.forked = lottery_forked,
+	.exiting = share_exiting,
+	.schedule = lottery_schedule,
+	.timeslice = lottery_timeslice,
+	.nr_ready = fcfs_nr_ready,
+	.steal = lottery_steal,
+	.enqueue = lottery_enqueue,
+};
@@ -0,0 +1,105 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+
+#include "pool.h"
+
+/**
+ * Objects and slab headers are aligned to this to hold any member type.
+ * A free object holds the link to the next free one at its start
+ */
+#define POOL_ALIGN	16
+
+static inline size_t __align(size_t size)
+{
+	return (size + POOL_ALIGN - 1) & ~((size_t)POOL_ALIGN - 1);
+}
+
+struct pool *pool_create(size_t size, unsigned int nr_per_slab)
+{
+	struct pool *pool = calloc(1, sizeof(*pool));
+
+	assert(pool);
+	assert(nr_per_slab > 0);
+
+	pool->size = __align(size < sizeof(void *) ? sizeof(void *) : size);
+	pool->nr_per_slab = nr_per_slab;
+
+	return pool;
+}
+
+void pool_destroy(struct pool *pool)
+{
+	while (pool->slabs) {
+		void *slab = pool->slabs;
+
+		pool->slabs = *(void **)slab;
+		free(slab);
+	}
+	free(pool);
+}
+
+/**
+ * Add a slab to carve fresh objects out of
+ */
+static void __grow(struct pool *pool)
+{
+	char *slab = malloc(__align(sizeof(void *)) + pool->size * pool->nr_per_slab);
+
+	assert(slab);
+
+	*(void **)slab = pool->slabs;
+	pool->slabs = slab;
+	pool->nr_slabs++;
+
+	pool->fresh = slab + __align(sizeof(void *));
+	pool->fresh_end = pool->fresh + pool->size * pool->nr_per_slab;
+}
+
+void *pool_alloc(struct pool *pool)
+{
+	void *object;
+
+	if (pool->free) {
+		object = pool->free;
+		pool->free = *(void **)object;
+	} else {
+		if (pool->fresh == pool->fresh_end) __grow(pool);
+
+		object = pool->fresh;
+		pool->fresh += pool->size;
+	}
+
+	pool->nr_allocs++;
+	if (++pool->nr_in_use > pool->max_in_use) pool->max_in_use = pool->nr_in_use;
+
+	return object;
+}
+
+void pool_free(struct pool *pool, void *object)
+{
+	assert(pool->nr_in_use > 0);
+
+	*(void **)object = pool->free;
+	pool->free = object;
+
+	pool->nr_frees++;
+	pool->nr_in_use--;
+}
@@ -0,0 +1,84 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+/***********************************************************************
+ * struct pool
+ *
+ * DESCRIPTION
+ *   Pool of fixed-size objects. Objects are carved out of slabs holding
+ *   @nr_per_slab objects each in the address order, and freed objects are
+ *   kept in a free list to be handed out again first. Slabs are returned
+ *   to the system only when the pool is destroyed.
+ *
+ *   The counters are to be read by users and not to be written.
+ */
+struct pool {
+	size_t size;			/* Size of an object including the padding */
+	unsigned int nr_per_slab;	/* # of objects in a slab */
+
+	void *free;			/* Freed objects linked through their first word */
+	void *slabs;			/* Slabs linked through their first word */
+	char *fresh;			/* Next object never handed out in the last slab */
+	char *fresh_end;
+
+	unsigned long nr_slabs;		/* # of slabs allocated */
+	unsigned long nr_allocs;	/* # of pool_alloc() calls */
+	unsigned long nr_frees;		/* # of pool_free() calls */
+	unsigned long nr_in_use;	/* # of objects allocated and not freed */
+	unsigned long max_in_use;	/* Peak of @nr_in_use */
+};
+
+
+/***********************************************************************
+ * pool_create()
+ *
+ * DESCRIPTION
+ *   Create a pool of objects of @size bytes, growing @nr_per_slab objects
+ *   at a time
+ */
+struct pool *pool_create(size_t size, unsigned int nr_per_slab);
+
+
+/***********************************************************************
+ * pool_destroy()
+ *
+ * DESCRIPTION
+ *   Free @pool with all of its slabs. Objects not freed yet are gone too.
+ */
+void pool_destroy(struct pool *pool);
+
+
+/***********************************************************************
+ * pool_alloc()
+ *
+ * RETURN
+ *   An uninitialized object from @pool
+ */
+void *pool_alloc(struct pool *pool);
+
+
+/***********************************************************************
+ * pool_free()
+ *
+ * DESCRIPTION
+ *   Put @object allocated from @pool back to @pool
+ */
+void pool_free(struct pool *pool, void *object);
+
+#endif
@@ -0,0 +1,209 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "prio_array.h"
+
+static inline int __prio_level(unsigned int prio)
+{
+	return prio < MAX_PRIO ? prio : MAX_PRIO;
+}
+
+static inline void __set_level(struct prio_array *array, int level)
+{
+	array->bitmap[level / BITS_PER_WORD] |= 1ULL << (level % BITS_PER_WORD);
+}
+
+static inline void __clear_level(struct prio_array *array, int level)
+{
+	array->bitmap[level / BITS_PER_WORD] &= ~(1ULL << (level % BITS_PER_WORD));
+}
+
+/**
+ * Find the highest occupied level. Returns -1 if the array is empty
+ */
+static inline int __highest_level(struct prio_array *array)
+{
+	for (int i = NR_PRIO_WORDS - 1; i >= 0; i--) {
+		if (array->bitmap[i]) {
+			return i * BITS_PER_WORD + (BITS_PER_WORD - 1) -
+					__builtin_clzll(array->bitmap[i]);
+		}
+	}
+	return -1;
+}
+
+/**
+ * Find the lowest occupied level. Returns -1 if the array is empty
+ */
+static inline int __lowest_level(struct prio_array *array)
+{
+	for (int i = 0; i < NR_PRIO_WORDS; i++) {
+		if (array->bitmap[i]) {
+			return i * BITS_PER_WORD + __builtin_ctzll(array->bitmap[i]);
+		}
+	}
+	return -1;
+}
+
+/**
+ * @p->rq_index unless @p has been merged up since it was enqueued
+ */
+static inline int __level_of(struct prio_array *array, struct process *p)
+{
+	if (p->rq_index < array->merged_level && p->rq_seq < array->merged_seq) {
+		return array->merged_level;
+	}
+	return p->rq_index;
+}
+
+/**
+ * Link @p into @level keeping the list sorted by the enqueueing order.
+ * Fresh enqueues always go to the tail, so the walk only happens on requeue
+ */
+static void __link_ordered(struct prio_array *array, struct process *p, int level)
+{
+	struct list_head *pos;
+
+	list_for_each_prev(pos, &array->queue[level]) {
+		struct process *q = list_entry(pos, struct process, list);
+		if (q->rq_seq < p->rq_seq) break;
+	}
+	list_add(&p->list, pos);
+
+	p->rq_index = level;
+	__set_level(array, level);
+}
+
+static void __unlink(struct prio_array *array, struct process *p)
+{
+	int level = __level_of(array, p);
+
+	list_del_init(&p->list);
+	if (list_empty(&array->queue[level])) {
+		__clear_level(array, level);
+	}
+	p->rq_index = -1;
+}
+
+void prio_array_init(struct prio_array *array)
+{
+	array->nr_active = 0;
+	array->seq = 0;
+	array->merged_seq = 0;
+	array->merged_level = 0;
+	for (int i = 0; i < NR_PRIO_WORDS; i++) {
+		array->bitmap[i] = 0;
+	}
+	for (int i = 0; i < NR_PRIO_LEVELS; i++) {
+		INIT_LIST_HEAD(&array->queue[i]);
+	}
+}
+
+void prio_array_enqueue(struct prio_array *array, struct process *p)
+{
+	prio_array_enqueue_level(array, p, __prio_level(p->prio));
+}
+
+void prio_array_enqueue_level(struct prio_array *array, struct process *p, int level)
+{
+	assert(list_empty(&p->list));
+	assert(level >= 0 && level < NR_PRIO_LEVELS);
+
+	p->rq_seq = array->seq++;
+	list_add_tail(&p->list, &array->queue[level]);
+	p->rq_index = level;
+	__set_level(array, level);
+
+	array->nr_active++;
+}
+
+void prio_array_dequeue(struct prio_array *array, struct process *p)
+{
+	assert(prio_array_queued(p));
+
+	__unlink(array, p);
+	array->nr_active--;
+}
+
+void prio_array_requeue(struct prio_array *array, struct process *p)
+{
+	int level = __prio_level(p->prio);
+
+	assert(prio_array_queued(p));
+	if (level == __level_of(array, p)) return;
+
+	__unlink(array, p);
+	__link_ordered(array, p, level);
+}
+
+void prio_array_merge(struct prio_array *array, int level)
+{
+	assert(!array->merged_seq || array->merged_level == level);
+
+	for (int i = level - 1; i >= 0; i--) {
+		if (list_empty(&array->queue[i])) continue;
+
+		list_splice_tail_init(&array->queue[i], &array->queue[level]);
+		__clear_level(array, i);
+		__set_level(array, level);
+	}
+	array->merged_seq = array->seq;
+	array->merged_level = level;
+}
+
+int prio_array_level(struct prio_array *array, struct process *p)
+{
+	assert(prio_array_queued(p));
+
+	return __level_of(array, p);
+}
+
+struct process *prio_array_peek(struct prio_array *array)
+{
+	int level = __highest_level(array);
+	struct process *p, *next = NULL;
+
+	if (level < 0) return NULL;
+
+	if (level < MAX_PRIO) {
+		return list_first_entry(&array->queue[level], struct process, list);
+	}
+
+	/**
+	 * The top level may hold processes with the priority beyond MAX_PRIO.
+	 * Pick the first one with the highest priority among them
+	 */
+	list_for_each_entry(p, &array->queue[level], list) {
+		if (!next || p->prio > next->prio) next = p;
+	}
+	return next;
+}
+
+struct process *prio_array_peek_tail(struct prio_array *array)
+{
+	int level = __lowest_level(array);
+
+	if (level < 0) return NULL;
+
+	return list_last_entry(&array->queue[level], struct process, list);
+}
@@ -0,0 +1,169 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PRIO_ARRAY_H__
+#define __PRIO_ARRAY_H__
+
+struct process;
+struct list_head;
+
+/**
+ * Number of priority levels. Priorities range from 0 to MAX_PRIO, and
+ * the processes with the priority larger than MAX_PRIO share the topmost
+ * level.
+ */
+#define NR_PRIO_LEVELS		(MAX_PRIO + 1)
+
+#define BITS_PER_WORD		64
+#define NR_PRIO_WORDS		((NR_PRIO_LEVELS + BITS_PER_WORD - 1) / BITS_PER_WORD)
+
+/***********************************************************************
+ * struct prio_array
+ *
+ * DESCRIPTION
+ *   Priority-indexed runqueue. Each priority level has its own list of
+ *   processes kept in the enqueueing order, and @bitmap tells which levels
+ *   are occupied so that the highest priority process can be found with
+ *   a single find-first-set over the bitmap words.
+ */
+struct prio_array {
+	unsigned int nr_active;
+	unsigned long long bitmap[NR_PRIO_WORDS];
+	struct list_head queue[NR_PRIO_LEVELS];
+	unsigned long long seq;
+
+	/**
+	 * The processes enqueued before @merged_seq below @merged_level have
+	 * been moved to @merged_level by prio_array_merge(). Their @rq_index
+	 * is left behind.
+	 */
+	unsigned long long merged_seq;
+	int merged_level;
+};
+
+
+/***********************************************************************
+ * prio_array_init()
+ *
+ * DESCRIPTION
+ *   Initialize @array to be empty
+ */
+void prio_array_init(struct prio_array *array);
+
+
+/***********************************************************************
+ * prio_array_enqueue()
+ *
+ * DESCRIPTION
+ *   Put @p at the tail of the level for @p->prio. @p should not be in any
+ *   list, and it is linked to the array through @p->list.
+ */
+void prio_array_enqueue(struct prio_array *array, struct process *p);
+
+
+/***********************************************************************
+ * prio_array_enqueue_level()
+ *
+ * DESCRIPTION
+ *   Put @p at the tail of @level regardless of @p->prio, for the schedulers
+ *   ranking the processes by something else than the priority. @level
+ *   should be less than MAX_PRIO.
+ */
+void prio_array_enqueue_level(struct prio_array *array, struct process *p, int level);
+
+
+/***********************************************************************
+ * prio_array_dequeue()
+ *
+ * DESCRIPTION
+ *   Detach @p from @array. @p->list is left initialized.
+ */
+void prio_array_dequeue(struct prio_array *array, struct process *p);
+
+
+/***********************************************************************
+ * prio_array_requeue()
+ *
+ * DESCRIPTION
+ *   Move @p to the level for its new @p->prio after the priority has been
+ *   changed while @p is in @array. @p keeps its position in the enqueueing
+ *   order, so it is served as if it has been in the new level from the
+ *   beginning.
+ */
+void prio_array_requeue(struct prio_array *array, struct process *p);
+
+
+/***********************************************************************
+ * prio_array_merge()
+ *
+ * DESCRIPTION
+ *   Move all processes below @level to the tail of @level, the ones in the
+ *   higher levels first, in O(levels). @level should be the same on every
+ *   merge, and prio_array_requeue() should not be used on a merged array
+ *   as the levels are no longer sorted by the enqueueing order.
+ */
+void prio_array_merge(struct prio_array *array, int level);
+
+
+/***********************************************************************
+ * prio_array_level()
+ *
+ * RETURN
+ *   The level @p is queued at on @array
+ */
+int prio_array_level(struct prio_array *array, struct process *p);
+
+
+/***********************************************************************
+ * prio_array_peek()
+ *
+ * DESCRIPTION
+ *   Find the process with the highest priority. Among the processes with
+ *   the same priority, the one enqueued first is returned.
+ *
+ * RETURN
+ *   The process with the highest priority, which is left in @array
+ *   NULL if @array is empty
+ */
+struct process *prio_array_peek(struct prio_array *array);
+
+
+/***********************************************************************
+ * prio_array_peek_tail()
+ *
+ * DESCRIPTION
+ *   Find the process that would be served last; the one enqueued last in
+ *   the lowest occupied level.
+ *
+ * RETURN
+ *   The process at the tail of @array, which is left in @array
+ *   NULL if @array is empty
+ */
+struct process *prio_array_peek_tail(struct prio_array *array);
+
+
+/***********************************************************************
+ * prio_array_queued()
+ *
+ * RETURN
+ *   true if @p is in a prio_array
+ *   false otherwise
+ */
+static inline bool prio_array_queued(struct process *p)
+{
+	return p->rq_index >= 0;
+}
+
+#endif
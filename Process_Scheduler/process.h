@@ -17,6 +17,12 @@
 #define __PROCESS_H__
 
 struct list_head;
+struct heap;
+struct heap_node;
+struct resource;
+struct cpu;
+struct sim;
+struct timer_wheel;
 
 enum process_status {
 	PROCESS_READY,		/* Process is ready to run */
@@ -39,6 +45,9 @@ struct process {
 							   0 by default, and the larger, the more important
 							   process it is */
 
+	unsigned int deadline;	/* Tick by which the process should exit.
+							   UINT_MAX if it has no deadline */
+
 	struct list_head list;	/* list head for listing processes */
 
 	/**
@@ -46,21 +55,77 @@ struct process {
 	 */
 	unsigned int prio_orig;	/* The original priority of the process */
 
+	bool blocked;			/* Waiting for a resource held by others */
+	bool shared;			/* Acquiring, releasing, or waiting for a resource in
+							   the shared mode. Set by the framework before
+							   calling acquire() and release() */
+	bool prio_dropped;		/* Priority got lowered by releasing a resource */
+	unsigned int slice_start;	/* Age when the current time slice started */
+	long long vruntime;		/* Virtual runtime on the fair scheduler */
+	unsigned int mlfq_level;	/* Level on the multi-level feedback queue. 0 at the top */
+	unsigned int mlfq_epoch;	/* Boost epoch when @mlfq_level was given */
+	long long pass;			/* Pass on the stride scheduler */
+	long long share_joined;		/* @cpu->global_pass when the process got runnable */
+	double entitled;		/* Ticks of the CPU the process deserves by its tickets.
+							   Kept by the proportional-share schedulers */
+
+	/**
+	 * Runqueue bookkeeping. Maintained by the runqueue helpers
+	 */
+	unsigned long long rq_seq;	/* Enqueueing order on the runqueue */
+	int rq_index;			/* Level on the priority array. -1 if not queued */
+	long long rq_key;		/* Sort key on the heap-ordered runqueues */
+	struct heap_node rq_node;	/* Node on the heap-ordered runqueues, or on
+							   @waiting_for->waiters or ->shared_waiters
+							   while waiting */
+	struct resource *waiting_for;	/* Resource waited for on its heap. NULL if none */
+	struct heap donations;		/* Resources held with waiters, ordered by the priority
+							   of their top waiters. Kept by the priority
+							   inheritance protocol */
+	struct list_head ceilings;	/* Resources held on the priority ceiling protocol.
+							   The latest acquired one comes first */
+	struct cpu *cpu;		/* CPU the process runs on */
+
 
 	/** DO NOT ACCESS FOLLOWING VARIABLES **/
 	unsigned int __starts_at;	/* When to fork the process */
 
+	unsigned int __period;		/* Ticks until the next job of a periodic process */
+	unsigned int __nr_jobs;		/* # of jobs left to release including this one */
+	bool __is_job;			/* Released by a periodic process, not from the script */
+
 	struct list_head __resources_to_acquire;
 								/* Schedule to acquire resources */
 
 	struct list_head __resources_holding;
 								/* Resources that the process is currently holding */
+
+	struct timer_wheel *__timers;
+								/* Times to acquire and release the resources */
+
+	struct list_head __processes;
+								/* List of the processes in the simulation */
+
+	unsigned int __first_run_at;	/* When the process got a CPU first */
+
+	unsigned int __blocked_at;	/* When the process got blocked on a resource */
+	unsigned int __blocked_ticks;	/* # of ticks blocked on resources */
+	unsigned int __nr_preemptions;	/* # of times taken off a CPU while runnable */
+	struct list_head __blocked_list;
+								/* List of the processes blocked on a resource */
+
+	int __waiting_on;		/* Resource the last acquire failed on. -1 if none */
+	bool __killed;			/* Killed to break a deadlock */
+
+	unsigned int __search;		/* Last deadlock search reaching the process */
+	struct process *__search_from;	/* Waiter the search reached it from */
+	struct list_head __search_list;	/* On the stack of the search */
 };
 
 /**
  * Support function to dump the process and resource status
  */
-void dump_status(void);
+void dump_status(struct sim *sim);
 
 #define MAX_PRIO	64	/* Maximum value for priority */
 
@@ -18,6 +18,8 @@
 
 struct process;
 struct list_head;
+struct heap;
+struct heap_node;
 
 /**
  * Resources in the system.
@@ -25,20 +27,74 @@ struct list_head;
 struct resource {
 	/**
 	 * The owner process of this resource. NULL implies the resource is free
-	 * whereas non-NULL implies @owner process owns this resource
+	 * whereas non-NULL implies @owner process owns this resource. Only
+	 * single-unit resources are owned; the holders of a multi-unit one
+	 * are just counted in @nr_holders
 	 */
 	struct process *owner;
 
+	unsigned int capacity;		/* # of units. 1 for a mutex */
+	unsigned int nr_holders;	/* # of units held */
+
+	/**
+	 * # of processes holding the resource in the shared mode. They hold it
+	 * together while no unit is held in the exclusive mode, and the
+	 * other way around
+	 */
+	unsigned int nr_readers;
+
 	/**
 	 * list head to list processes that are wanting for the resource
 	 */
 	struct list_head waitqueue;
+
+	/**
+	 * Processes wanting for the resource in the shared mode. They are kept
+	 * apart from the writers on @waitqueue so that a release can wake them
+	 * up all together
+	 */
+	struct list_head shared_waitqueue;
+
+	/**
+	 * Processes waiting for the resource in the order of their priority.
+	 * Among those with the same priority, the one waiting longer comes
+	 * first. The priority schedulers put the waiters here instead of
+	 * @waitqueue with @rq_seq taken from @seq. Call heap_update() after
+	 * changing the priority of a waiter
+	 */
+	struct heap waiters;
+	struct heap shared_waiters;	/* Ditto for the waiters in the shared mode */
+	unsigned long long seq;		/* Waiting order on @waiters and @shared_waiters */
+
+	/**
+	 * Node on @owner->donations while @owner holds the resource and
+	 * @waiters or @shared_waiters is not empty
+	 */
+	struct heap_node donation;
+
+	/**
+	 * Highest priority of the processes acquiring the resource. Worked out
+	 * as the processes are loaded, so it is complete only with the whole
+	 * script loaded rather than streamed
+	 */
+	unsigned int ceiling;
+
+	/**
+	 * The priority ceiling protocol stacks the resources held by a process
+	 * on @owner->ceilings, the latest on the top. @stack_ceiling is the
+	 * highest ceiling from the bottom up to this resource, which is the
+	 * priority the owner runs at while this is on the top
+	 */
+	struct list_head ceiling_list;
+	unsigned int stack_ceiling;
 };
 
 /**
- * This system has 16 different resources. It is defined in sched.c as an array of
- * struct resource (i.e., struct resource resources[NR_RESOURCES];)
+ * This system has 16 different resources by default. It is allocated in sched.c
+ * as an array of struct resource (i.e., sim->resources[sim->nr_resources]) as
+ * the script is loaded, and it can have up to MAX_NR_RESOURCES resources
  */
 #define NR_RESOURCES 16
+#define MAX_NR_RESOURCES (1 << 20)
 
 #endif
@@ -19,52 +19,82 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <assert.h>
+#include <stdint.h>
+#include <fcntl.h>
 #include <unistd.h>
-#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "types.h"
 #include "list_head.h"
+#include "heap.h"
 
 #include "parser.h"
+#include "script.h"
 #include "process.h"
 #include "resource.h"
+#include "timer_wheel.h"
+#include "pool.h"
+#include "event_log.h"
+#include "metrics.h"
+#include "prio_array.h"
+#include "cpu.h"
+#include "sim.h"
 
 #include "sched.h"
 
 /**
- * List head to hold the processes ready to run
+ * Following code is to maintain the simulator itself.
  */
-LIST_HEAD(readyqueue);
+struct resource_schedule {
+	int resource_id;
+	int at;
+	int duration;
+	bool shared;		/* Acquire in the shared mode */
+	struct list_head list;
+	struct timer timer;
 
-/**
- * The process that is currently running
- */
-struct process *current = NULL;
+	/* On @sim->__held_by[@resource_id] while @holder holds the resource */
+	struct list_head held_list;
+	struct process *holder;
+};
 
 /**
- * Number of generated ticks since the simulator was started
+ * A script read just ahead of the simulated clock in the streaming mode.
+ * Either @file for a text script or @header for a mapped binary one
  */
-unsigned int ticks = 0;
+struct script_stream {
+	FILE *file;
+	const struct script_header *header;
+	size_t size;
+	uint32_t next;			/* Next process record in @header */
+	unsigned int last_starts_at;	/* Forking time of the last process read */
+	bool failed;			/* Stopped at a process not to simulate */
+};
 
 /**
- * Resources in the system.
+ * Processes and resource schedules are allocated from the pools of the
+ * simulation this many at a time
  */
-struct resource resources[NR_RESOURCES];
+#define NR_OBJECTS_PER_SLAB	1024
 
 /**
- * Following code is to maintain the simulator itself.
+ * Resource schedules of a process are timed on the per-process timer wheel
+ * which ticks twice per age; releases that come at age @a fire at
+ * 2 * @a - 1 after the process gets aged to @a, and acquisitions at age @a
+ * fire at 2 * @a before the process runs at age @a.
  */
-struct resource_schedule {
-	int resource_id;
-	int at;
-	int duration;
-	struct list_head list;
-};
-
-static LIST_HEAD(__forkqueue);
+static inline unsigned int __acquire_time(unsigned int age)
+{
+	return age * 2;
+}
 
-bool quiet = false;
+static inline unsigned int __release_time(unsigned int age)
+{
+	return age * 2 - 1;
+}
 
 static const char * __process_status_sz[] = {
 	"RDY",
@@ -73,451 +103,1901 @@ static const char * __process_status_sz[] = {
 	"EXT",
 };
 
-/**
- * Assorted schedulers
- */
-extern struct scheduler fifo_scheduler;
-extern struct scheduler sjf_scheduler;
-extern struct scheduler srtf_scheduler;
-extern struct scheduler rr_scheduler;
-extern struct scheduler prio_scheduler;
-extern struct scheduler pa_scheduler;
-extern struct scheduler pcp_scheduler;
-extern struct scheduler pip_scheduler;
-
-static struct scheduler *sched = &fifo_scheduler;
+static const char * __balance_strategy_sz[] = {
+	"none",
+	"pull",
+	"push",
+};
 
-void dump_status(void)
+void dump_status(struct sim *sim)
 {
 	struct process *p;
+	struct cpu *cpu;
+	FILE *out = sim->out;
 
-	printf("***** CURRENT *********\n");
-	if (current) {
-		printf("%2d (%s): %d + %d/%d at %d\n",
-				current->pid, __process_status_sz[current->status],
-				current->__starts_at,
-				current->age, current->lifespan, current->prio);
-	}
+	for_each_cpu(sim, cpu) {
+		struct process *current = cpu->current;
+
+		if (sim->nr_cpus > 1) {
+			fprintf(out, "***** CPU %-3u *********\n", cpu->id);
+		}
+
+		fprintf(out, "***** CURRENT *********\n");
+		if (current) {
+			fprintf(out, "%2d (%s): %d + %d/%d at %d\n",
+					current->pid, __process_status_sz[current->status],
+					current->__starts_at,
+					current->age, current->lifespan, current->prio);
+		}
 
-	printf("***** READY QUEUE *****\n");
-	list_for_each_entry(p, &readyqueue, list) {
-		printf("%2d (%s): %d + %d/%d at %d\n",
-				p->pid, __process_status_sz[p->status],
-				p->__starts_at, p->age, p->lifespan, p->prio);
+		fprintf(out, "***** READY QUEUE *****\n");
+		list_for_each_entry(p, &cpu->readyqueue, list) {
+			fprintf(out, "%2d (%s): %d + %d/%d at %d\n",
+					p->pid, __process_status_sz[p->status],
+					p->__starts_at, p->age, p->lifespan, p->prio);
+		}
 	}
 
-	printf("***** RESOURCES *******\n");
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		struct resource *r = resources + i;;
-		if (r->owner || !list_empty(&r->waitqueue)) {
-			printf("%2d: owned by ", i);
-			if (r->owner) {
-				printf("%d\n", r->owner->pid);
+	fprintf(out, "***** RESOURCES *******\n");
+	for (unsigned int i = 0; i < sim->nr_resources; i++) {
+		struct resource *r = sim->resources + i;;
+		if (r->nr_holders || r->nr_readers ||
+				!list_empty(&r->waitqueue) || !list_empty(&r->shared_waitqueue) ||
+				!heap_empty(&r->waiters) || !heap_empty(&r->shared_waiters)) {
+			if (r->nr_readers) {
+				fprintf(out, "%2d: shared by %u\n", i, r->nr_readers);
+			} else if (r->capacity > 1) {
+				fprintf(out, "%2d: held %u/%u\n", i, r->nr_holders, r->capacity);
+			} else if (r->owner) {
+				fprintf(out, "%2d: owned by %d\n", i, r->owner->pid);
 			} else {
-				printf("no one\n");
+				fprintf(out, "%2d: owned by no one\n", i);
 			}
 
 			list_for_each_entry(p, &r->waitqueue, list) {
-				printf("    %d is waiting\n", p->pid);
+				fprintf(out, "    %d is waiting\n", p->pid);
+			}
+			list_for_each_entry(p, &r->shared_waitqueue, list) {
+				fprintf(out, "    %d is waiting to share\n", p->pid);
+			}
+			for (unsigned int j = 1; j <= r->waiters.nr_nodes; j++) {
+				p = container_of(r->waiters.nodes[j], struct process, rq_node);
+				fprintf(out, "    %d is waiting at %d\n", p->pid, p->prio);
+			}
+			for (unsigned int j = 1; j <= r->shared_waiters.nr_nodes; j++) {
+				p = container_of(r->shared_waiters.nodes[j], struct process, rq_node);
+				fprintf(out, "    %d is waiting to share at %d\n", p->pid, p->prio);
 			}
 		}
 	}
-	printf("\n\n");
+	fprintf(out, "\n\n");
 
 	return;
 }
 
-#define __print_event(pid, string, args...) do { \
-	fprintf(stderr, "%3d: ", ticks); \
-	for (int i = 0; i < pid; i++) { \
-		fprintf(stderr, "    "); \
-	} \
-	fprintf(stderr, string "\n", ##args); \
-} while (0);
+/**
+ * Log an event on @cpu to the binary event log and to the text log
+ */
+static void __print_event(struct cpu *cpu, unsigned int pid, enum event_type type, int arg)
+{
+	struct sim *sim = cpu->sim;
+	struct event event = {
+		.tick = sim->ticks,
+		.pid = pid,
+		.type = type,
+		.cpu = cpu->id,
+		.arg = arg,
+	};
+
+	if (sim->__events) event_log_append(sim->__events, &event);
+	if (sim->log) event_print(sim->log, &event, sim->nr_cpus);
+}
 
 static inline bool strmatch(char * const str, const char *expect)
 {
 	return (strlen(str) == strlen(expect)) && (strncmp(str, expect, strlen(expect)) == 0);
 }
 
-static void __briefing_process(struct process *p)
+static void __briefing_process(struct sim *sim, struct process *p)
 {
 	struct resource_schedule *rs;
 
-	if (quiet) return;
+	if (sim->quiet) return;
 
-	printf("- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d\n",
+	fprintf(sim->out, "- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d\n",
 				p->pid, p->__starts_at, p->lifespan,
 				p->lifespan >= 2 ? "s" : "", p->prio);
 
+	if (p->deadline != UINT_MAX) {
+		fprintf(sim->out, "    Due by tick %u\n", p->deadline);
+	}
+	if (p->__nr_jobs > 1) {
+		fprintf(sim->out, "    Released %u times every %u ticks\n", p->__nr_jobs, p->__period);
+	}
 	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
-		printf("    Acquire resource %d at %d for %d\n", rs->resource_id, rs->at, rs->duration);
+		fprintf(sim->out, "    Acquire resource %d at %d for %d%s\n", rs->resource_id,
+				rs->at, rs->duration, rs->shared ? " shared" : "");
 	}
 }
 
-static int __load_script(char * const filename)
+/**
+ * Set the # of units of @resource_id
+ */
+static void __set_capacity(struct sim *sim, int resource_id, unsigned int capacity)
 {
-	char line[256];
-	struct process *p = NULL;
+	sim->resources[resource_id].capacity = capacity;
 
-	FILE *file = fopen(filename, "r");
-	while (fgets(line, sizeof(line), file)) {
-		char *tokens[32] = { NULL };
-		int nr_tokens;
+	if (sim->quiet || sim->streaming) return;
 
-		parse_command(line, &nr_tokens, tokens);
+	fprintf(sim->out, "- Resource %d: Held by up to %u processes at a time\n",
+				resource_id, capacity);
+}
 
-		if (nr_tokens == 0) continue;
+struct __fork_entry {
+	struct process *p;
+	unsigned int order;
+};
 
-		if (strmatch(tokens[0], "process")) {
-			assert(nr_tokens == 2);
-			/* Start processor description */
-			p = malloc(sizeof(*p));
-			memset(p, 0x00, sizeof(*p));
+static int __compare_fork_entry(const void *a, const void *b)
+{
+	const struct __fork_entry *ea = a, *eb = b;
 
-			p->pid = atoi(tokens[1]);
+	if (ea->p->__starts_at != eb->p->__starts_at) {
+		return ea->p->__starts_at < eb->p->__starts_at ? -1 : 1;
+	}
+	return ea->order < eb->order ? -1 : 1;
+}
+
+/**
+ * Sort @__forkqueue by the forking time. The processes to be forked at
+ * the same tick are kept in the script order
+ */
+static void __sort_forkqueue(struct sim *sim)
+{
+	struct __fork_entry *entries;
+	struct process *p, *tmp;
+	unsigned int nr_processes = 0;
+	bool sorted = true;
+	unsigned int last_starts_at = 0;
+
+	list_for_each_entry(p, &sim->__forkqueue, list) {
+		if (p->__starts_at < last_starts_at) sorted = false;
+		last_starts_at = p->__starts_at;
+		nr_processes++;
+	}
+	if (sorted) return;
 
-			INIT_LIST_HEAD(&p->list);
-			INIT_LIST_HEAD(&p->__resources_to_acquire);
-			INIT_LIST_HEAD(&p->__resources_holding);
+	entries = malloc(sizeof(*entries) * nr_processes);
+	assert(entries);
 
-			continue;
-		} else if (strmatch(tokens[0], "end")) {
-			/* End of process description */
-			struct resource_schedule *rs;
-			assert(p);
+	nr_processes = 0;
+	list_for_each_entry_safe(p, tmp, &sim->__forkqueue, list) {
+		entries[nr_processes].p = p;
+		entries[nr_processes].order = nr_processes;
+		nr_processes++;
+		list_del_init(&p->list);
+	}
 
-			list_add_tail(&p->list, &__forkqueue);
+	qsort(entries, nr_processes, sizeof(*entries), __compare_fork_entry);
 
-			__briefing_process(p);
-			p = NULL;
+	for (unsigned int i = 0; i < nr_processes; i++) {
+		list_add_tail(&entries[i].p->list, &sim->__forkqueue);
+	}
+	free(entries);
+}
 
-			continue;
-		}
+/**
+ * Free @p with the resource schedules it has left
+ */
+static void __free_process(struct sim *sim, struct process *p)
+{
+	struct resource_schedule *rs, *tmp;
 
-		if (strmatch(tokens[0], "lifespan")) {
-			assert(nr_tokens == 2);
-			p->lifespan = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "prio")) {
-			assert(nr_tokens == 2);
-			p->prio = p->prio_orig = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "start")) {
-			assert(nr_tokens == 2);
-			p->__starts_at = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "acquire")) {
-			struct resource_schedule *rs;
-			assert(nr_tokens == 4);
+	list_for_each_entry_safe(rs, tmp, &p->__resources_to_acquire, list) {
+		list_del(&rs->list);
+		pool_free(sim->__schedule_pool, rs);
+	}
+	list_for_each_entry_safe(rs, tmp, &p->__resources_holding, list) {
+		list_del(&rs->list);
+		list_del(&rs->held_list);
+		pool_free(sim->__schedule_pool, rs);
+	}
+	list_del(&p->__processes);
+	list_del(&p->__blocked_list);
 
-			rs = malloc(sizeof(*rs));
+	if (p->__timers) timer_wheel_destroy(p->__timers);
+	heap_destroy(&p->donations);
 
-			rs->resource_id = atoi(tokens[1]);
-			rs->at = atoi(tokens[2]);
-			rs->duration = atoi(tokens[3]);
+	pool_free(sim->__process_pool, p);
+}
 
-			list_add_tail(&rs->list, &p->__resources_to_acquire);
-		} else {
-			fprintf(stderr, "Unknown property %s\n", tokens[0]);
-			return false;
+/**
+ * Time the resource schedules of @p
+ */
+static void __arm_timers(struct process *p)
+{
+	struct resource_schedule *rs;
+
+	if (!list_empty(&p->__resources_to_acquire)) {
+		unsigned int horizon = p->lifespan;
+
+		list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+			if (rs->at + rs->duration > horizon) {
+				horizon = rs->at + rs->duration;
+			}
+		}
+		p->__timers = timer_wheel_create(__release_time(horizon) + 2);
+
+		list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+			timer_wheel_add(p->__timers, &rs->timer, __acquire_time(rs->at));
 		}
 	}
-	fclose(file);
-	if (!quiet) printf("\n");
-	return true;
 }
 
-
 /**
- * Fork process on schedule
+ * Put @p into @__forkqueue in the forking order. At the same tick, the
+ * processes from the script are forked before the jobs of periodic processes
+ * regardless of when they are queued, so streaming does not change the order.
+ * The processes are mostly queued in the forking order, so the walk from
+ * the tail is short
  */
-static int __fork_on_schedule()
+static void __queue_fork(struct sim *sim, struct process *p)
 {
-	int nr_forked = 0;
-	struct process *p, *tmp;
-	list_for_each_entry_safe(p, tmp, &__forkqueue, list) {
-		if (p->__starts_at <= ticks) {
-			//dump_status();
-			list_move_tail(&p->list, &readyqueue);
-			//dump_status();
-			p->status = PROCESS_READY;
-			__print_event(p->pid, "N");
-			if (sched->forked) sched->forked(p);
-			//dump_status();
-			nr_forked++;
-		}
+	struct list_head *pos;
+
+	list_for_each_prev(pos, &sim->__forkqueue) {
+		struct process *q = list_entry(pos, struct process, list);
+
+		if (q->__starts_at < p->__starts_at) break;
+		if (q->__starts_at == p->__starts_at && (p->__is_job || !q->__is_job)) break;
 	}
-	return nr_forked;
+	list_add(&p->list, pos);
 }
 
 /**
- * Exit the process
+ * Raise the ceilings of the resources @p acquires to its priority
  */
-static void __exit_process(struct process *p)
+static void __raise_ceilings(struct sim *sim, struct process *p)
 {
-	/* Make sure the process is not attached to some list head */
-	assert(list_empty(&p->list));
-
-	/* Make sure the process is not holding any resource */
-	assert(list_empty(&p->__resources_holding));
+	struct resource_schedule *rs;
 
-	/* Make sure there is no pending resource to acquire */
-	assert(list_empty(&p->__resources_to_acquire));
+	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+		struct resource *r = sim->resources + rs->resource_id;
 
-	if (sched->exiting) sched->exiting(p);
+		if (p->prio_orig > r->ceiling) r->ceiling = p->prio_orig;
+	}
+}
 
-	__print_event(p->pid, "X");
+/**
+ * Time the resource schedules of @p and queue it to be forked
+ */
+static void __setup_process(struct sim *sim, struct process *p)
+{
+	__arm_timers(p);
+	__raise_ceilings(sim, p);
+
+	/* Loaded scripts are sorted as a whole afterward */
+	if (sim->streaming) {
+		__queue_fork(sim, p);
+	} else {
+		list_add_tail(&p->list, &sim->__forkqueue);
+	}
 
-	free(p);
+	/* Streamed processes are not known in advance to brief them */
+	if (!sim->streaming) __briefing_process(sim, p);
 }
 
+/**
+ * Order of the waiters on @resource->waiters. The higher priority comes
+ * first, and then the one waiting longer
+ */
+static bool __waiter_less(struct heap_node *a, struct heap_node *b)
+{
+	struct process *pa = container_of(a, struct process, rq_node);
+	struct process *pb = container_of(b, struct process, rq_node);
+
+	if (pa->prio != pb->prio) return pa->prio > pb->prio;
+	return pa->rq_seq < pb->rq_seq;
+}
 
 /**
- * Process resource acqutision
+ * Waiter of the highest priority on either heap of @r
  */
-static bool __run_current_acquire()
+static unsigned int __top_waiter_prio(struct resource *r)
 {
-	struct resource_schedule *rs, *tmp;
+	struct heap_node *a = heap_peek(&r->waiters);
+	struct heap_node *b = heap_peek(&r->shared_waiters);
+	unsigned int prio = 0;
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
-		if (rs->at == current->age) {
-			assert(sched->acquire && "scheduler.acquire() not implemented");
-
-			//fprintf(stderr,"acquire1\n");
-			//dump_status();
-			/* Callback to acquire the resource */
-			if (sched->acquire(rs->resource_id)) {
-				list_move_tail(&rs->list, &current->__resources_holding);
-				//fprintf(stderr,"acuire in if\n");
-				//dump_status();
-	
-				__print_event(current->pid, "+%d", rs->resource_id);
-			} else {
-				//fprintf(stderr,"acquire in else\n");
-				//dump_status();
-				return false;
-			}
-		}
+	if (a) prio = container_of(a, struct process, rq_node)->prio;
+	if (b && container_of(b, struct process, rq_node)->prio > prio) {
+		prio = container_of(b, struct process, rq_node)->prio;
 	}
-	//fprintf(stderr,"acquire in end\n");
-	//dump_status();
+	return prio;
+}
 
-	return true;
+/**
+ * Order of the resources on @process->donations. The one with the waiter
+ * of the higher priority comes first
+ */
+static bool __donation_less(struct heap_node *a, struct heap_node *b)
+{
+	struct resource *ra = container_of(a, struct resource, donation);
+	struct resource *rb = container_of(b, struct resource, donation);
+
+	return __top_waiter_prio(ra) > __top_waiter_prio(rb);
 }
 
 /**
- * Process resource release
+ * Allocate @sim->nr_resources resources of a unit each
  */
-static void __run_current_release()
+static void __alloc_resources(struct sim *sim)
 {
-	struct resource_schedule *rs, *tmp;
+	assert(sim->nr_resources >= 1 && sim->nr_resources <= MAX_NR_RESOURCES);
+
+	sim->resources = calloc(sim->nr_resources, sizeof(*sim->resources));
+	sim->__blocked_on = malloc(sizeof(*sim->__blocked_on) * sim->nr_resources);
+	sim->__held_by = malloc(sizeof(*sim->__held_by) * sim->nr_resources);
+	assert(sim->resources && sim->__blocked_on && sim->__held_by);
+
+	for (unsigned int i = 0; i < sim->nr_resources; i++) {
+		sim->resources[i].owner = NULL;
+		sim->resources[i].capacity = 1;
+		INIT_LIST_HEAD(&(sim->resources[i].waitqueue));
+		INIT_LIST_HEAD(&sim->resources[i].shared_waitqueue);
+		heap_init(&sim->resources[i].waiters, __waiter_less);
+		heap_init(&sim->resources[i].shared_waiters, __waiter_less);
+		INIT_LIST_HEAD(&sim->resources[i].ceiling_list);
+		INIT_LIST_HEAD(&sim->__blocked_on[i]);
+		INIT_LIST_HEAD(&sim->__held_by[i]);
+	}
+}
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_holding, list) {
-		if (--rs->duration == 0) {
-			assert(sched->release && "scheduler.release() not implemented");
+/**
+ * Allocate a process to load from a script and put it in the simulation
+ */
+static struct process *__alloc_process(struct sim *sim)
+{
+	struct process *p = pool_alloc(sim->__process_pool);
+
+	memset(p, 0x00, sizeof(*p));
+	p->rq_index = -1;
+	p->deadline = UINT_MAX;
+	p->__nr_jobs = 1;
+	p->__first_run_at = UINT_MAX;
+	p->__waiting_on = -1;
+	heap_init(&p->donations, __donation_less);
+	sim->nr_processes++;
+
+	INIT_LIST_HEAD(&p->list);
+	INIT_LIST_HEAD(&p->__resources_to_acquire);
+	INIT_LIST_HEAD(&p->__resources_holding);
+	INIT_LIST_HEAD(&p->__blocked_list);
+	INIT_LIST_HEAD(&p->ceilings);
+	INIT_LIST_HEAD(&p->__search_list);
+	list_add_tail(&p->__processes, &sim->__processes);
+
+	return p;
+}
 
-			/* Callback the release() */
-			sched->release(rs->resource_id);
+/**
+ * Queue the job of periodic @p to be released a period after @p
+ */
+static void __queue_next_job(struct sim *sim, struct process *p)
+{
+	struct process *job = __alloc_process(sim);
+	struct resource_schedule *rs;
 
-			__print_event(current->pid, "-%d", rs->resource_id);
+	job->pid = p->pid;
+	job->lifespan = p->lifespan;
+	job->prio = job->prio_orig = p->prio_orig;
+	job->__starts_at = p->__starts_at + p->__period;
+	job->__period = p->__period;
+	job->__nr_jobs = p->__nr_jobs - 1;
+	job->__is_job = true;
+	if (p->deadline != UINT_MAX) job->deadline = p->deadline + p->__period;
 
-			list_del(&rs->list);
-			free(rs);
-		}
+	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+		struct resource_schedule *copy = pool_alloc(sim->__schedule_pool);
+
+		copy->resource_id = rs->resource_id;
+		copy->at = rs->at;
+		copy->duration = rs->duration;
+		copy->shared = rs->shared;
+		list_add_tail(&copy->list, &job->__resources_to_acquire);
 	}
+
+	__arm_timers(job);
+	__queue_fork(sim, job);
 }
 
+/**
+ * Give @p the deadline @relative ticks after its forking. Periodic processes
+ * are due by the next period if no deadline is given
+ */
+static void __set_deadline(struct process *p, unsigned int relative)
+{
+	if (relative == UINT_MAX && p->__period) relative = p->__period;
+	if (relative == UINT_MAX) return;
 
-/***********************************************************************
- * The main loop for the scheduler simulation
+	p->deadline = p->__starts_at + relative;
+}
+
+/**
+ * Read the next process from the text script @file into @pp. @pp is set
+ * to NULL at the end of the script
  */
-static void __do_simulation(void)
+static int __read_text_process(struct sim *sim, FILE *file, struct process **pp)
 {
-	assert(sched->schedule && "scheduler.schedule() not implemented");
+	char line[256];
+	struct process *p = NULL;
+	unsigned int deadline = UINT_MAX;
 
-	while (true) {
-		struct process *prev;
+	*pp = NULL;
 
-		/* Fork processes on schedule */
-		__fork_on_schedule();
+	while (fgets(line, sizeof(line), file)) {
+		char *tokens[32] = { NULL };
+		int nr_tokens;
 
-		/* Ask scheduler to pick the next process to run */
-		prev = current;
-		current = sched->schedule();
+		parse_command(line, &nr_tokens, tokens);
 
-		/* If the system ran a process in the previous tick, */
-		if (prev) {
-			/* Update the process status */
-			if (prev->status == PROCESS_RUNNING) {
-				prev->status = PROCESS_READY;
-			}
+		if (nr_tokens == 0) continue;
 
-			/* Decommission it if completed */
-			if (prev->age == prev->lifespan) {
-				prev->status = PROCESS_EXIT;
-				__exit_process(prev);
-			}
-		}
+		if (strmatch(tokens[0], "resource")) {
+			int resource_id;
 
-		/* No process is ready to run at this moment */
-		if (!current) {
-			/* Quit simulation if no pending process exists */
-			if (list_empty(&readyqueue) && list_empty(&__forkqueue)) {
-				break;
+			assert(nr_tokens == 3);
+			resource_id = atoi(tokens[1]);
+			if (p || resource_id < 0 || resource_id >= sim->nr_resources ||
+					atoi(tokens[2]) < 1) {
+				fprintf(stderr, "Invalid resource %s\n", tokens[1]);
+				if (p) __free_process(sim, p);
+				return -1;
 			}
+			__set_capacity(sim, resource_id, atoi(tokens[2]));
 
-			/* Idle temporarily */
-			fprintf(stderr, "%3d: idle\n", ticks);
-		} else {
+			continue;
+		} else if (strmatch(tokens[0], "process")) {
+			assert(nr_tokens == 2);
+			/* Start processor description */
+			p = __alloc_process(sim);
+			p->pid = atoi(tokens[1]);
+
+			continue;
+		} else if (strmatch(tokens[0], "end")) {
+			/* End of process description */
+			assert(p);
+
+			__set_deadline(p, deadline);
+			*pp = p;
+			return 0;
+		}
 
-			/* Execute the current process */
-			current->status = PROCESS_RUNNING;
+		if (strmatch(tokens[0], "lifespan")) {
+			assert(nr_tokens == 2);
+			p->lifespan = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "prio")) {
+			assert(nr_tokens == 2);
+			p->prio = p->prio_orig = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "start")) {
+			assert(nr_tokens == 2);
+			p->__starts_at = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "acquire")) {
+			struct resource_schedule *rs;
+			assert(nr_tokens == 4 || nr_tokens == 5);
 
-			/* Ensure that @current is detached from any list */
-			assert(list_empty(&current->list));
+			rs = pool_alloc(sim->__schedule_pool);
 
-			/* Try acquiring scheduled resources */
-			if (__run_current_acquire()) {
-				/* Succesfully acquired all the resources to make a progress! */
-				__print_event(current->pid, "%d", current->pid);
+			rs->resource_id = atoi(tokens[1]);
+			rs->at = atoi(tokens[2]);
+			rs->duration = atoi(tokens[3]);
+			rs->shared = false;
 
-				/* So, it ages by one tick */
-				current->age++;
-				
-				/* And performs scheduled releases */
-				__run_current_release();
-				
+			list_add_tail(&rs->list, &p->__resources_to_acquire);
 
-			} else {
-				/**
-				 * The current is blocked while acquiring resource(s).
-				 * In this case, @current could not make a progress in this tick
-				 */
-				__print_event(current->pid, "=");
-				//dump_status();
-				/* Thus, it is not get aged nor unable to perform releases */
+			if (nr_tokens == 5) {
+				if (strmatch(tokens[4], "shared")) {
+					rs->shared = true;
+				} else if (!strmatch(tokens[4], "exclusive")) {
+					fprintf(stderr, "Unknown acquire mode %s\n", tokens[4]);
+					__free_process(sim, p);
+					return -1;
+				}
+			}
+			if (rs->resource_id < 0 || rs->resource_id >= sim->nr_resources) {
+				fprintf(stderr, "Process %d acquires resource %d out of %u resources\n",
+						p->pid, rs->resource_id, sim->nr_resources);
+				__free_process(sim, p);
+				return -1;
+			}
+		} else if (strmatch(tokens[0], "deadline")) {
+			assert(nr_tokens == 2);
+			deadline = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "period")) {
+			assert(nr_tokens == 3);
+			p->__period = atoi(tokens[1]);
+			p->__nr_jobs = atoi(tokens[2]);
+			if (p->__period < 1 || p->__nr_jobs < 1) {
+				fprintf(stderr, "Invalid period of process %d\n", p->pid);
+				__free_process(sim, p);
+				return -1;
 			}
+		} else {
+			fprintf(stderr, "Unknown property %s\n", tokens[0]);
+			if (p) __free_process(sim, p);
+			return -1;
 		}
-
-		/* Increase the tick counter */
-		ticks++;
 	}
+	return 0;
 }
 
-
-static void __initialize(void)
+static inline const struct script_process *__script_processes(
+		const struct script_header *header)
 {
-	INIT_LIST_HEAD(&readyqueue);
-
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		resources[i].owner = NULL;
-		INIT_LIST_HEAD(&(resources[i].waitqueue));
-	}
-
-	INIT_LIST_HEAD(&__forkqueue);
-
-	if (quiet) return;
-	printf("               _              _ \n");
-	printf("              | |            | |\n");
-	printf("      ___  ___| |__   ___  __| |\n");
-	printf("     / __|/ __| '_ \\ / _ \\/ _` |\n");
-	printf("     \\__ \\ (__| | | |  __/ (_| |\n");
-	printf("     |___/\\___|_| |_|\\___|\\__,_|\n");
-	printf("\n");
-	printf("                                 2021 Fall\n");
-	printf("      Simulating %s scheduler\n", sched->name);
-	printf("\n");
-	printf("****************************************************\n");
-	printf("   N: Forked\n");
-	printf("   X: Finished\n");
-	printf("   =: Blocked\n");
-	printf("  +n: Acquire resource n\n");
-	printf("  -n: Release resource n\n");
-	printf("\n");
+	return (const struct script_process *)(header + 1);
 }
 
-
-static void __print_usage(char * const name)
+static inline const struct script_schedule *__script_schedules(
+		const struct script_header *header)
 {
-	printf("Usage: %s {-q} -[f|s|S|r|a|p|i] [process script file]\n", name);
-	printf("\n");
-	printf("  -q: Run quietly\n\n");
-	printf("  -f: Use FIFO scheduler (default)\n");
-	printf("  -s: Use SJF scheduler\n");
-	printf("  -S: Use SRTF scheduler\n");
-	printf("  -r: Use Round-robin scheduler\n");
-	printf("  -p: Use Priority scheduler\n");
-	printf("  -a: Use Priority scheduler with aging\n");
-	printf("  -c: Use Priority scheduler with PCP\n");
-	printf("  -i: Use Priority scheduler with PIP\n");
-	printf("\n");
+	return (const struct script_schedule *)
+			(__script_processes(header) + header->nr_processes);
 }
 
-
-int main(int argc, char * const argv[])
+static inline const struct script_capacity *__script_capacities(
+		const struct script_header *header)
 {
-	int opt;
-	char *scriptfile;
-
-	while ((opt = getopt(argc, argv, "qfsSrpaich")) != -1) {
-		switch (opt) {
-		case 'q':
-			quiet = true;
-			break;
+	return (const struct script_capacity *)
+			(__script_schedules(header) + header->nr_schedules);
+}
 
-		case 'f':
-			sched = &fifo_scheduler;
-			break;
-		case 's':
-			sched = &sjf_scheduler;
-			break;
-		case 'S':
-			sched = &srtf_scheduler;
-			break;
-		case 'r':
-			sched = &rr_scheduler;
-			break;
-		case 'p':
-			sched = &prio_scheduler;
-			break;
-		case 'a':
-			sched = &pa_scheduler;
-			break;
-		case 'i':
-			sched = &pip_scheduler;
-			break;
-		case 'c':
-			sched = &pcp_scheduler;
-			break;
-		case 'h':
-		default:
-			__print_usage(argv[0]);
-			return EXIT_FAILURE;
+/**
+ * Check the records of the binary script mapped at @header as a whole, so
+ * the records can be read afterward without checking them one by one
+ */
+static bool __validate_binary_script(struct sim *sim,
+		const struct script_header *header, size_t size)
+{
+	const struct script_process *sp = __script_processes(header);
+	const struct script_schedule *ss = __script_schedules(header);
+	const struct script_capacity *sc = __script_capacities(header);
+
+	if (size < sizeof(*header) || header->version != SCRIPT_VERSION) return false;
+	if (size != sizeof(*header) +
+			(uint64_t)header->nr_processes * sizeof(*sp) +
+			(uint64_t)header->nr_schedules * sizeof(*ss) +
+			(uint64_t)header->nr_capacities * sizeof(*sc)) return false;
+
+	for (uint32_t i = 0; i < header->nr_processes; i++) {
+		if (sp[i].first_schedule > header->nr_schedules ||
+				sp[i].nr_schedules > header->nr_schedules - sp[i].first_schedule) {
+			return false;
 		}
+		if (sp[i].nr_jobs < 1 || (sp[i].nr_jobs > 1 && sp[i].period < 1)) return false;
+	}
+	for (uint32_t i = 0; i < header->nr_schedules; i++) {
+		if (ss[i].resource_id < 0 || ss[i].resource_id >= sim->nr_resources) return false;
+		if (ss[i].flags & ~SCRIPT_SHARED) return false;
+	}
+	for (uint32_t i = 0; i < header->nr_capacities; i++) {
+		if (sc[i].resource_id < 0 || sc[i].resource_id >= sim->nr_resources) return false;
+		if (sc[i].capacity < 1) return false;
 	}
+	return true;
+}
+
+/**
+ * Map @filename if it is a binary script.
+ *
+ * RETURN
+ *   0 with @header and @size set if @filename is mapped
+ *   1 if @filename is not a binary script
+ *   -1 if @filename cannot be opened or is malformed
+ */
+static int __map_binary_script(struct sim *sim, const char *filename,
+		const struct script_header **header, size_t *size)
+{
+	struct stat st;
+	void *map;
+	int fd = open(filename, O_RDONLY);
 
-	if (optind >= argc) {
-		__print_usage(argv[0]);
-		return EXIT_FAILURE;
+	if (fd < 0) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return -1;
 	}
 
-	scriptfile = argv[optind];
+	if (fstat(fd, &st) || st.st_size < SCRIPT_MAGIC_LEN) {
+		close(fd);
+		return 1;
+	}
 
-	__initialize();
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return 1;
 
-	if (!__load_script(scriptfile)) {
-		return EXIT_FAILURE;
+	if (memcmp(map, SCRIPT_MAGIC, SCRIPT_MAGIC_LEN)) {
+		munmap(map, st.st_size);
+		return 1;
 	}
 
-	if (sched->initialize && sched->initialize()) {
-		return EXIT_FAILURE;
+	if (!__validate_binary_script(sim, map, st.st_size)) {
+		fprintf(stderr, "Malformed binary script %s\n", filename);
+		munmap(map, st.st_size);
+		return -1;
 	}
 
-	__do_simulation();
+	*header = map;
+	*size = st.st_size;
+	return 0;
+}
+
+/**
+ * Fill @p with the @i-th process record of @header
+ */
+static void __read_binary_process(struct sim *sim, struct process *p,
+		const struct script_header *header, uint32_t i)
+{
+	const struct script_process *sp = __script_processes(header) + i;
+	const struct script_schedule *ss = __script_schedules(header);
+
+	p->pid = sp->pid;
+	p->__starts_at = sp->start;
+	p->lifespan = sp->lifespan;
+	p->prio = p->prio_orig = sp->prio;
+	p->__period = sp->period;
+	p->__nr_jobs = sp->nr_jobs;
+	__set_deadline(p, sp->deadline == UINT32_MAX ? UINT_MAX : sp->deadline);
+
+	for (uint32_t j = sp->first_schedule; j < sp->first_schedule + sp->nr_schedules; j++) {
+		struct resource_schedule *rs = pool_alloc(sim->__schedule_pool);
+
+		rs->resource_id = ss[j].resource_id;
+		rs->at = ss[j].at;
+		rs->duration = ss[j].duration;
+		rs->shared = ss[j].flags & SCRIPT_SHARED;
+
+		list_add_tail(&rs->list, &p->__resources_to_acquire);
+	}
+}
+
+/**
+ * Set the capacities of the resources in the binary script mapped at @header
+ */
+static void __read_binary_capacities(struct sim *sim, const struct script_header *header)
+{
+	const struct script_capacity *sc = __script_capacities(header);
+
+	for (uint32_t i = 0; i < header->nr_capacities; i++) {
+		__set_capacity(sim, sc[i].resource_id, sc[i].capacity);
+	}
+}
+
+/**
+ * Load every process in the binary script mapped at @header
+ */
+static void __load_binary_script(struct sim *sim, const struct script_header *header)
+{
+	for (uint32_t i = 0; i < header->nr_processes; i++) {
+		struct process *p = __alloc_process(sim);
+
+		__read_binary_process(sim, p, header, i);
+		__setup_process(sim, p);
+	}
+}
+
+static bool __resources_supported(struct sim *sim, struct process *p)
+{
+	return list_empty(&p->__resources_to_acquire) ||
+			(sim->sched->acquire && sim->sched->release);
+}
+
+/**
+ * The ceiling protocol raises the owner of a resource, so it does not
+ * cover the resources of more than one unit or those held in the shared
+ * mode, which have no single owner
+ */
+static bool __ceilings_supported(struct sim *sim, struct process *p)
+{
+	struct resource_schedule *rs;
+
+	if (!sim->sched->ceilings) return true;
+
+	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+		if (rs->shared || sim->resources[rs->resource_id].capacity > 1) return false;
+	}
+	return true;
+}
+
+/**
+ * Read the next process from the script being streamed and queue it to be
+ * forked. 1 if a process is read, 0 at the end of the script, and -1 if
+ * the process cannot be simulated
+ */
+static int __stream_process(struct sim *sim)
+{
+	struct script_stream *stream = sim->__stream;
+	struct process *p = NULL;
+
+	if (stream->file) {
+		if (__read_text_process(sim, stream->file, &p)) return -1;
+	} else if (stream->next < stream->header->nr_processes) {
+		p = __alloc_process(sim);
+		__read_binary_process(sim, p, stream->header, stream->next++);
+	}
+	if (!p) return 0;
+
+	if (p->__starts_at < stream->last_starts_at) {
+		fprintf(stderr, "Process %d is forked before the previous one. "
+				"Streamed scripts should be sorted by the forking time\n", p->pid);
+		return -1;
+	}
+	if (!__resources_supported(sim, p)) {
+		fprintf(stderr, "%s scheduler does not support resources\n", sim->sched->name);
+		return -1;
+	}
+	stream->last_starts_at = p->__starts_at;
+
+	__setup_process(sim, p);
+	return 1;
+}
+
+static void __close_stream(struct script_stream *stream)
+{
+	if (stream->file) fclose(stream->file);
+	if (stream->header) munmap((void *)stream->header, stream->size);
+	stream->file = NULL;
+	stream->header = NULL;
+}
+
+/**
+ * Read the streamed script until a process not due yet is in @__forkqueue.
+ * Processes are held only from just before they are forked until they exit
+ */
+static void __stream_processes(struct sim *sim)
+{
+	struct script_stream *stream = sim->__stream;
+
+	/* The whole script has been read or the stream has failed */
+	if (!stream || (!stream->file && !stream->header)) return;
+
+	/* The jobs of periodic processes may be queued after the last one read */
+	while (stream->last_starts_at <= sim->ticks) {
+		int ret = __stream_process(sim);
+
+		if (ret <= 0) {
+			stream->failed = ret < 0;
+			__close_stream(stream);
+			break;
+		}
+	}
+}
+
+int sim_load_script(struct sim *sim, const char *filename)
+{
+	const struct script_header *header = NULL;
+	size_t size = 0;
+	struct process *p;
+	FILE *file = NULL;
+	int ret;
+
+	if (!sim->resources) __alloc_resources(sim);
+
+	ret = __map_binary_script(sim, filename, &header, &size);
+	if (ret < 0) return -1;
+
+	if (ret) {
+		header = NULL;
+		file = fopen(filename, "r");
+		if (!file) {
+			fprintf(stderr, "Cannot open %s\n", filename);
+			return -1;
+		}
+	}
+
+	if (header) __read_binary_capacities(sim, header);
+
+	/* Processes are read while the simulation is going on */
+	if (sim->streaming) {
+		assert(!sim->__stream && "Only one script can be streamed at a time");
+
+		sim->__stream = malloc(sizeof(*sim->__stream));
+		assert(sim->__stream);
+		memset(sim->__stream, 0x00, sizeof(*sim->__stream));
+
+		sim->__stream->file = file;
+		sim->__stream->header = header;
+		sim->__stream->size = size;
+		return 0;
+	}
+
+	if (header) {
+		__load_binary_script(sim, header);
+		munmap((void *)header, size);
+	} else {
+		while (!(ret = __read_text_process(sim, file, &p)) && p) {
+			__setup_process(sim, p);
+		}
+		fclose(file);
+		if (ret) return -1;
+	}
+	if (!sim->quiet) fprintf(sim->out, "\n");
+
+	__sort_forkqueue(sim);
+	return 0;
+}
+
+int sim_save_script(struct sim *sim, const char *filename)
+{
+	struct script_header header = {
+		.version = SCRIPT_VERSION,
+	};
+	struct process *p;
+	struct resource_schedule *rs;
+	FILE *file;
+
+	memcpy(header.magic, SCRIPT_MAGIC, SCRIPT_MAGIC_LEN);
+
+	list_for_each_entry(p, &sim->__processes, __processes) {
+		header.nr_processes++;
+		list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+			header.nr_schedules++;
+		}
+	}
+	for (unsigned int i = 0; i < sim->nr_resources; i++) {
+		if (sim->resources[i].capacity > 1) header.nr_capacities++;
+	}
+
+	file = fopen(filename, "wb");
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return -1;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+
+	/* Processes in the script order, and their schedules in the same order */
+	header.nr_schedules = 0;
+	list_for_each_entry(p, &sim->__processes, __processes) {
+		struct script_process sp = {
+			.pid = p->pid,
+			.start = p->__starts_at,
+			.lifespan = p->lifespan,
+			.prio = p->prio_orig,
+			.first_schedule = header.nr_schedules,
+			.deadline = p->deadline == UINT_MAX ? UINT32_MAX : p->deadline - p->__starts_at,
+			.period = p->__period,
+			.nr_jobs = p->__nr_jobs,
+		};
+
+		list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+			sp.nr_schedules++;
+		}
+		header.nr_schedules += sp.nr_schedules;
+
+		fwrite(&sp, sizeof(sp), 1, file);
+	}
+
+	list_for_each_entry(p, &sim->__processes, __processes) {
+		list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+			struct script_schedule ss = {
+				.resource_id = rs->resource_id,
+				.at = rs->at,
+				.duration = rs->duration,
+				.flags = rs->shared ? SCRIPT_SHARED : 0,
+			};
+			fwrite(&ss, sizeof(ss), 1, file);
+		}
+	}
+
+	for (unsigned int i = 0; i < sim->nr_resources; i++) {
+		struct script_capacity sc = {
+			.resource_id = i,
+			.capacity = sim->resources[i].capacity,
+		};
+
+		if (sc.capacity > 1) fwrite(&sc, sizeof(sc), 1, file);
+	}
+
+	if (ferror(file) | fclose(file)) {
+		fprintf(stderr, "Cannot write %s\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * Fork process on schedule. @__forkqueue is sorted by the forking time,
+ * so only the processes due at this tick are examined
+ */
+static int __fork_on_schedule(struct sim *sim)
+{
+	int nr_forked = 0;
+	struct process *p, *tmp;
+
+	__stream_processes(sim);
+
+	list_for_each_entry_safe(p, tmp, &sim->__forkqueue, list) {
+		if (p->__starts_at > sim->ticks) break;
+
+		/* Spread the processes over the CPUs in the forking order */
+		p->cpu = sim->cpus + (sim->__nr_forked++ % sim->nr_cpus);
+
+		//dump_status(sim);
+		list_move_tail(&p->list, &p->cpu->readyqueue);
+		//dump_status(sim);
+		p->status = PROCESS_READY;
+		if (p->__nr_jobs > 1) __queue_next_job(sim, p);
+		__print_event(p->cpu, p->pid, EVENT_FORK, 0);
+		if (sim->sched->forked) sim->sched->forked(p->cpu, p);
+		//dump_status(sim);
+		nr_forked++;
+	}
+	return nr_forked;
+}
+
+/**
+ * Exit the process
+ */
+static void __exit_process(struct process *p)
+{
+	struct sim *sim = p->cpu->sim;
+
+	/* Make sure the process is not attached to some list head */
+	assert(list_empty(&p->list));
+
+	/* Make sure the process is not holding any resource */
+	assert(list_empty(&p->__resources_holding));
+
+	/* Make sure there is no pending resource to acquire */
+	assert(list_empty(&p->__resources_to_acquire));
+
+	if (sim->sched->exiting) sim->sched->exiting(p->cpu, p);
+
+	/* It has been reported when killed */
+	if (p->__killed) {
+		__free_process(sim, p);
+		return;
+	}
+
+	sim->nr_exited++;
+	sim->total_turnaround += sim->ticks - p->__starts_at;
+	sim->total_waiting += sim->ticks - p->__starts_at - p->lifespan;
+	sim->total_response += p->__first_run_at - p->__starts_at;
+
+	if (p->deadline != UINT_MAX) {
+		sim->nr_deadlines++;
+		if (sim->ticks > p->deadline) {
+			unsigned int lateness = sim->ticks - p->deadline;
+
+			sim->nr_missed++;
+			sim->total_lateness += lateness;
+			if (lateness > sim->max_lateness) sim->max_lateness = lateness;
+		}
+	}
+
+	if (sim->metrics) {
+		/* Processes are forked right at @__starts_at */
+		struct metrics_record record = {
+			.pid = p->pid,
+			.lifespan = p->lifespan,
+			.arrival = p->__starts_at,
+			.first_run = p->__first_run_at,
+			.completion = sim->ticks,
+			.blocked = p->__blocked_ticks,
+			.nr_preemptions = p->__nr_preemptions,
+			.entitled = p->entitled,
+		};
+		metrics_add(sim->metrics, &record);
+	}
+
+	__print_event(p->cpu, p->pid, EVENT_EXIT, 0);
+
+	__free_process(sim, p);
+}
+
+
+/**
+ * Account the ticks blocked to the processes woken up by a release of
+ * @resource_id. They are blocked through the tick they are woken up
+ */
+static void __account_wakeups(struct sim *sim, int resource_id)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &sim->__blocked_on[resource_id], __blocked_list) {
+		if (p->status == PROCESS_WAIT) continue;
+
+		p->__blocked_ticks += sim->ticks - p->__blocked_at + 1;
+		list_del_init(&p->__blocked_list);
+	}
+}
+
+/**
+ * Tell whether @p acquiring @resource_id in the mode of @p->shared is to
+ * wait. It follows resource_available() of the schedulers, which serve
+ * the readers and the writers as @sim->rw_preference tells
+ */
+static bool __would_wait(struct sim *sim, struct process *p, int resource_id)
+{
+	struct resource *r = sim->resources + resource_id;
+
+	if (p->shared) {
+		if (r->nr_holders) return true;
+		if (sim->rw_preference == RW_PREFER_READERS) return false;
+
+		return !list_empty(&r->waitqueue) || !heap_empty(&r->waiters);
+	}
+	return r->nr_readers || r->nr_holders == r->capacity;
+}
+
+/**
+ * Tell whether @p waiting for @resource_id waits for every process holding
+ * it. A writer waits for all the readers to leave, and a reader for all the
+ * writers; a reader held back for the waiting writers also waits for the
+ * readers in, since the writers do. A writer waiting for a multi-unit
+ * resource held by writers is let in by any of them, so it is not followed
+ */
+static bool __waits_for_holders(struct sim *sim, struct process *p, int resource_id)
+{
+	struct resource *r = sim->resources + resource_id;
+
+	return p->shared || r->nr_readers || r->capacity == 1;
+}
+
+/**
+ * Tell whether @p waiting for @resource_id would close a cycle in the
+ * wait-for graph, and return the last waiter on the cycle, or NULL if none.
+ * A waiter has an edge to each holder of the resource it waits for when
+ * all of them have to leave, and the graph is searched from @resource_id
+ * in depth with the waiters reached on @__search_list. Each process is
+ * visited once a search, and @__search_from of those on the cycle leads
+ * back from the returned one to @p
+ */
+static struct process *__closes_cycle(struct sim *sim, struct process *p, int resource_id)
+{
+	LIST_HEAD(stack);
+	unsigned int search = ++sim->__nr_searches;
+	struct process *waiter = p;
+
+	p->__search = search;
+	while (true) {
+		struct resource_schedule *rs;
+
+		if (__waits_for_holders(sim, waiter, resource_id)) {
+			list_for_each_entry(rs, &sim->__held_by[resource_id], held_list) {
+				struct process *holder = rs->holder;
+
+				if (holder == p) {
+					while (!list_empty(&stack)) list_del_init(stack.next);
+					return waiter;
+				}
+				if (holder->__search == search) continue;
+
+				holder->__search = search;
+				holder->__search_from = waiter;
+				if (holder->status == PROCESS_WAIT && holder->__waiting_on >= 0) {
+					list_add(&holder->__search_list, &stack);
+				}
+			}
+		}
+		if (list_empty(&stack)) return NULL;
+
+		waiter = list_first_entry(&stack, struct process, __search_list);
+		list_del_init(&waiter->__search_list);
+		resource_id = waiter->__waiting_on;
+	}
+}
+
+/**
+ * Report the cycle @p waiting for @resource_id closes, which runs back to
+ * @p from @last along @__search_from. The links are reversed in place to
+ * print the cycle from @p forward
+ */
+static void __report_deadlock(struct sim *sim, struct process *p, int resource_id,
+		struct process *last)
+{
+	FILE *out = sim->deadlock == DEADLOCK_ABORT ? stderr : sim->out;
+	struct process *waiter = last, *next = p;
+
+	while (waiter != p) {
+		struct process *from = waiter->__search_from;
+
+		waiter->__search_from = next;
+		next = waiter;
+		waiter = from;
+	}
+
+	if (sim->quiet && out == sim->out) return;
+
+	fprintf(out, "Deadlock at tick %u\n", sim->ticks);
+	do {
+		fprintf(out, "    Process %d waits for resource %d held by process %d\n",
+				waiter->pid, resource_id, next->pid);
+
+		waiter = next;
+		resource_id = waiter->__waiting_on;
+		next = waiter->__search_from;
+	} while (waiter != p);
+}
+
+/**
+ * Tell whether any process is left blocked on a resource at the end of the
+ * simulation. They wait in a deadlock the search does not follow, such as
+ * a cycle through a multi-unit resource whose holders all wait for each
+ * other
+ */
+static bool __stalled(struct sim *sim)
+{
+	struct process *p;
+
+	list_for_each_entry(p, &sim->__processes, __processes) {
+		if (p->__waiting_on >= 0) return true;
+	}
+	return false;
+}
+
+static void __report_stalled(struct sim *sim)
+{
+	FILE *out = sim->deadlock == DEADLOCK_ABORT ? stderr : sim->out;
+	struct process *p;
+
+	if (sim->quiet && out == sim->out) return;
+
+	fprintf(out, "Deadlock at tick %u\n", sim->ticks);
+	list_for_each_entry(p, &sim->__processes, __processes) {
+		if (p->__waiting_on < 0) continue;
+
+		fprintf(out, "    Process %d waits for resource %d for good\n",
+				p->pid, p->__waiting_on);
+	}
+}
+
+/**
+ * Kill @cpu->current to break the deadlock it is about to close. It gives
+ * back the resources it holds, drops the ones it has yet to acquire, and
+ * is taken off as completed on the next tick
+ */
+static void __kill_current(struct cpu *cpu)
+{
+	struct sim *sim = cpu->sim;
+	struct process *current = cpu->current;
+	struct resource_schedule *rs, *tmp;
+
+	list_for_each_entry_safe(rs, tmp, &current->__resources_holding, list) {
+		timer_wheel_del(current->__timers, &rs->timer);
+
+		current->shared = rs->shared;
+		sim->sched->release(cpu, rs->resource_id);
+		if (sim->metrics) __account_wakeups(sim, rs->resource_id);
+
+		__print_event(cpu, current->pid, EVENT_RELEASE, rs->resource_id);
+
+		list_del(&rs->list);
+		list_del(&rs->held_list);
+		pool_free(sim->__schedule_pool, rs);
+	}
+	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
+		timer_wheel_del(current->__timers, &rs->timer);
+
+		list_del(&rs->list);
+		pool_free(sim->__schedule_pool, rs);
+	}
+
+	current->lifespan = current->age;
+	current->__killed = true;
+	sim->nr_killed++;
+
+	__print_event(cpu, current->pid, EVENT_KILL, 0);
+}
+
+/**
+ * Process resource acqutision
+ */
+static bool __run_current_acquire(struct cpu *cpu)
+{
+	struct sim *sim = cpu->sim;
+	struct scheduler *sched = sim->sched;
+	struct process *current = cpu->current;
+	struct timer_wheel *timers = current->__timers;
+	struct timer *timer;
+	struct process *last;
+
+	if (!timers) return true;
+
+	timer_wheel_advance(timers, __acquire_time(current->age));
+
+	while ((timer = timer_wheel_first_due(timers))) {
+		struct resource_schedule *rs =
+				container_of(timer, struct resource_schedule, timer);
+
+		assert(sched->acquire && "scheduler.acquire() not implemented");
+
+		/* Do not let it wait for good */
+		current->shared = rs->shared;
+		if (sim->deadlock != DEADLOCK_IGNORE &&
+				__would_wait(sim, current, rs->resource_id) &&
+				(last = __closes_cycle(sim, current, rs->resource_id))) {
+			__report_deadlock(sim, current, rs->resource_id, last);
+
+			if (sim->deadlock == DEADLOCK_ABORT) {
+				sim->__deadlocked = true;
+			} else {
+				__kill_current(cpu);
+			}
+			return false;
+		}
+
+		/* Callback to acquire the resource in the mode of the schedule */
+		if (sched->acquire(cpu, rs->resource_id)) {
+			current->__waiting_on = -1;
+			list_move_tail(&rs->list, &current->__resources_holding);
+			list_add_tail(&rs->held_list, &sim->__held_by[rs->resource_id]);
+			rs->holder = current;
+
+			/* Schedule the release. The resource is held forever with no duration */
+			timer_wheel_del(timers, timer);
+			if (rs->duration > 0) {
+				timer_wheel_add(timers, timer,
+						__release_time(current->age + rs->duration));
+			}
+
+			__print_event(cpu, current->pid, EVENT_ACQUIRE, rs->resource_id);
+		} else {
+			/* Blocked until a release of the resource wakes it up */
+			current->__waiting_on = rs->resource_id;
+			if (cpu->sim->metrics) {
+				current->__blocked_at = cpu->sim->ticks;
+				list_move_tail(&current->__blocked_list,
+						&cpu->sim->__blocked_on[rs->resource_id]);
+			}
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Process resource release
+ */
+static void __run_current_release(struct cpu *cpu)
+{
+	struct scheduler *sched = cpu->sim->sched;
+	struct process *current = cpu->current;
+	struct timer_wheel *timers = current->__timers;
+	struct timer *timer;
+
+	if (!timers) return;
+
+	timer_wheel_advance(timers, __release_time(current->age));
+
+	while ((timer = timer_wheel_first_due(timers))) {
+		struct resource_schedule *rs =
+				container_of(timer, struct resource_schedule, timer);
+
+		assert(sched->release && "scheduler.release() not implemented");
+
+		timer_wheel_del(timers, timer);
+
+		/* Callback the release() */
+		current->shared = rs->shared;
+		sched->release(cpu, rs->resource_id);
+		if (cpu->sim->metrics) __account_wakeups(cpu->sim, rs->resource_id);
+
+		__print_event(cpu, current->pid, EVENT_RELEASE, rs->resource_id);
+
+		list_del(&rs->list);
+		list_del(&rs->held_list);
+		pool_free(cpu->sim->__schedule_pool, rs);
+	}
+}
+
+
+/**
+ * Tick when the next process in @__forkqueue is forked. UINT_MAX if none
+ */
+static unsigned int __next_fork_at(struct sim *sim)
+{
+	if (list_empty(&sim->__forkqueue)) return UINT_MAX;
+
+	return list_first_entry(&sim->__forkqueue, struct process, list)->__starts_at;
+}
+
+/**
+ * Number of ticks @cpu->current can run before it reaches the next resource
+ * acquisition or release, or its end of life
+ */
+static unsigned int __run_until_event(struct cpu *cpu)
+{
+	struct process *current = cpu->current;
+	unsigned int nr_ticks;
+
+	if (current->age >= current->lifespan) return 0;
+	nr_ticks = current->lifespan - current->age;
+
+	if (current->__timers) {
+		unsigned int next = timer_wheel_next_expiry(current->__timers);
+
+		/**
+		 * An acquisition at 2a needs the tick at age a, and a release at
+		 * 2a - 1 happens in the tick at age a - 1. Both are a tick at age
+		 * floor(next / 2), which is left to the main loop
+		 */
+		if (next != UINT_MAX) {
+			unsigned int age = next / 2;
+
+			if (age <= current->age) return 0;
+			if (age - current->age < nr_ticks) nr_ticks = age - current->age;
+		}
+	}
+	return nr_ticks;
+}
+
+/**
+ * Load of @cpu, counting its current
+ */
+static unsigned int __load(struct cpu *cpu)
+{
+	return cpu->sim->sched->nr_ready(cpu) + (cpu->current ? 1 : 0);
+}
+
+/**
+ * Move the process at the tail of the runqueue of @src to @dst
+ */
+static bool __migrate(struct cpu *src, struct cpu *dst)
+{
+	struct scheduler *sched = src->sim->sched;
+	struct process *p = sched->steal(src);
+
+	if (!p) return false;
+
+	p->cpu = dst;
+	sched->enqueue(dst, p);
+
+	src->__nr_migrated_out++;
+	dst->__nr_migrated_in++;
+	__print_event(dst, p->pid, EVENT_MIGRATE, src->id);
+
+	return true;
+}
+
+/**
+ * Steal a process for idle @cpu from the CPU with the most ready processes
+ */
+static bool __steal_for_idle(struct cpu *cpu)
+{
+	struct sim *sim = cpu->sim;
+	struct cpu *c, *busiest = NULL;
+	unsigned int max_ready = 0;
+
+	for_each_cpu(sim, c) {
+		unsigned int nr_ready;
+
+		if (c == cpu) continue;
+
+		nr_ready = sim->sched->nr_ready(c);
+		if (nr_ready > max_ready) {
+			max_ready = nr_ready;
+			busiest = c;
+		}
+	}
+
+	if (!busiest || !__migrate(busiest, cpu)) return false;
+
+	cpu->__nr_stolen++;
+	return true;
+}
+
+/**
+ * Even out the load. With pulling, each CPU takes processes from the
+ * busiest CPU, and with pushing, each CPU gives processes to the least
+ * loaded CPU. Either way, half of the difference is moved at a time
+ */
+static void __rebalance(struct sim *sim)
+{
+	unsigned int load[MAX_NR_CPUS];
+	bool pull = sim->balance == BALANCE_PULL;
+	struct cpu *cpu;
+
+	for_each_cpu(sim, cpu) {
+		load[cpu->id] = __load(cpu);
+	}
+
+	for_each_cpu(sim, cpu) {
+		struct cpu *c, *peer = cpu;
+		struct cpu *src, *dst;
+		unsigned int nr_moves;
+
+		for_each_cpu(sim, c) {
+			if (pull ? load[c->id] > load[peer->id] : load[c->id] < load[peer->id]) {
+				peer = c;
+			}
+		}
+		if (peer == cpu) continue;
+
+		src = pull ? peer : cpu;
+		dst = pull ? cpu : peer;
+
+		for (nr_moves = (load[src->id] - load[dst->id]) / 2; nr_moves; nr_moves--) {
+			if (!__migrate(src, dst)) break;
+			load[src->id]--;
+			load[dst->id]++;
+		}
+	}
+}
+
+/**
+ * Report how the load was balanced across the CPUs
+ */
+static void __report_balance(struct sim *sim)
+{
+	struct cpu *cpu;
+	FILE *out = sim->out;
+	unsigned int ticks = sim->ticks;
+	unsigned int nr_stolen = 0, nr_migrated = 0;
+	unsigned int min_ran = UINT_MAX, max_ran = 0;
+
+	fprintf(out, "\n");
+	fprintf(out, "****************************************************\n");
+	fprintf(out, "  Load balancing: %s", __balance_strategy_sz[sim->balance]);
+	if (sim->balance != BALANCE_NONE) {
+		fprintf(out, " every %u ticks", sim->balance_interval);
+	}
+	fprintf(out, "\n\n");
+	fprintf(out, "   CPU    Ran   Util  Stolen    In   Out\n");
+
+	for_each_cpu(sim, cpu) {
+		fprintf(out, "  %4u %6u %5.1f%% %7u %5u %5u\n", cpu->id,
+				cpu->__nr_ran, ticks ? 100.0 * cpu->__nr_ran / ticks : 0.0,
+				cpu->__nr_stolen, cpu->__nr_migrated_in, cpu->__nr_migrated_out);
+
+		nr_stolen += cpu->__nr_stolen;
+		nr_migrated += cpu->__nr_migrated_in;
+		if (cpu->__nr_ran < min_ran) min_ran = cpu->__nr_ran;
+		if (cpu->__nr_ran > max_ran) max_ran = cpu->__nr_ran;
+	}
+
+	fprintf(out, "\n");
+	fprintf(out, "  Steals: %u, migrations: %u, utilisation difference: %.1f%%\n",
+			nr_stolen, nr_migrated, ticks ? 100.0 * (max_ran - min_ran) / ticks : 0.0);
+}
+
+static void __report_deadlines(struct sim *sim)
+{
+	FILE *out = sim->out;
+
+	fprintf(out, "\n");
+	fprintf(out, "****************************************************\n");
+	fprintf(out, "  Deadlines\n\n");
+	fprintf(out, "  Met: %u, missed: %u", sim->nr_deadlines - sim->nr_missed, sim->nr_missed);
+	if (sim->nr_missed) {
+		fprintf(out, ", lateness: %.2f on average, %u at most",
+				(double)sim->total_lateness / sim->nr_missed, sim->max_lateness);
+	}
+	fprintf(out, "\n");
+}
+
+static void __report_pool(FILE *out, const char *name, struct pool *pool)
+{
+	fprintf(out, "  %-18s %10lu %10lu %10lu %6lu %8zu\n", name,
+			pool->nr_allocs, pool->nr_frees, pool->max_in_use,
+			pool->nr_slabs, pool->nr_slabs * pool->nr_per_slab * pool->size);
+}
+
+static void __report_pools(struct sim *sim)
+{
+	FILE *out = sim->out;
+
+	fprintf(out, "\n");
+	fprintf(out, "****************************************************\n");
+	fprintf(out, "  Object pools\n\n");
+	fprintf(out, "  %-18s %10s %10s %10s %6s %8s\n",
+			"Object", "Allocs", "Frees", "Peak", "Slabs", "Bytes");
+	__report_pool(out, "process", sim->__process_pool);
+	__report_pool(out, "resource_schedule", sim->__schedule_pool);
+}
+
+
+/**
+ * Log the CPUs running their current processes or idling for @nr_ticks
+ * from now on. The binary log takes a span for each CPU, whereas the text
+ * log is written out tick by tick just like the main loop does
+ */
+static void __log_span(struct sim *sim, unsigned int nr_ticks)
+{
+	struct event spans[MAX_NR_CPUS];
+	struct cpu *cpu;
+
+	if (!sim->__events && !sim->log) return;
+
+	for_each_cpu(sim, cpu) {
+		spans[cpu->id] = (struct event) {
+			.tick = sim->ticks,
+			.pid = cpu->current ? cpu->current->pid : 0,
+			.type = cpu->current ? EVENT_RUN_SPAN : EVENT_IDLE_SPAN,
+			.cpu = cpu->id,
+			.arg = nr_ticks,
+		};
+		if (sim->__events) event_log_append(sim->__events, spans + cpu->id);
+	}
+	if (sim->log) event_print_span(sim->log, spans, sim->nr_cpus);
+}
+
+/**
+ * Fast-forward the simulation to the next tick where something other than
+ * idling or aging the current processes happens, in O(1) but for the text
+ * log of the ticks being skipped
+ */
+static void __skip_to_next_event(struct sim *sim)
+{
+	struct scheduler *sched = sim->sched;
+	unsigned int next_fork_at = __next_fork_at(sim);
+	unsigned int nr_ticks = next_fork_at - sim->ticks;
+	bool running = false, idle = false;
+	struct cpu *cpu;
+
+	/* Do not go beyond the limit */
+	if (sim->max_ticks && sim->max_ticks - sim->ticks < nr_ticks) {
+		nr_ticks = sim->max_ticks - sim->ticks;
+	}
 
+	/* The load gets balanced at every @balance_interval ticks */
+	if (sim->balance != BALANCE_NONE) {
+		unsigned int since = sim->ticks % sim->balance_interval;
+
+		if (since == 0) return;
+		if (sim->balance_interval - since < nr_ticks) {
+			nr_ticks = sim->balance_interval - since;
+		}
+	}
+
+	for_each_cpu(sim, cpu) {
+		unsigned int nr_cpu_ticks;
+
+		if (!cpu->current) {
+			/* Someone woken up by other CPUs will be picked on the next tick */
+			if (!list_empty(&cpu->readyqueue) || cpu->prio_array.nr_active ||
+					!heap_empty(&cpu->heap)) return;
+
+			/* Otherwise, idle CPUs have nothing to run until the next fork */
+			idle = true;
+			continue;
+		}
+
+		/* @current is blocked or has not been decided to keep running */
+		if (cpu->current->status != PROCESS_RUNNING || !sched->timeslice) return;
+
+		nr_cpu_ticks = sched->timeslice(cpu);
+		if (nr_cpu_ticks <= 1) return;
+
+		if (__run_until_event(cpu) < nr_cpu_ticks) {
+			nr_cpu_ticks = __run_until_event(cpu);
+		}
+		if (nr_cpu_ticks < nr_ticks) nr_ticks = nr_cpu_ticks;
+		running = true;
+	}
+
+	/* Nothing becomes ready anymore */
+	if (!running && next_fork_at == UINT_MAX) return;
+
+	/* Idle CPUs will steal processes from busy ones */
+	if (idle && sim->balance == BALANCE_PULL) {
+		for_each_cpu(sim, cpu) {
+			if (sched->nr_ready(cpu)) return;
+		}
+	}
+
+	__log_span(sim, nr_ticks);
+
+	for_each_cpu(sim, cpu) {
+		if (cpu->current) {
+			cpu->current->age += nr_ticks;
+			cpu->__nr_ran += nr_ticks;
+		}
+	}
+	sim->ticks += nr_ticks;
+}
+
+
+/**
+ * Run @cpu->current for a tick
+ */
+static void __run_current(struct cpu *cpu)
+{
+	struct process *current = cpu->current;
+
+	/* Execute the current process */
+	current->status = PROCESS_RUNNING;
+	if (current->__first_run_at == UINT_MAX) {
+		current->__first_run_at = cpu->sim->ticks;
+	}
+
+	/* Ensure that @current is detached from any list */
+	assert(list_empty(&current->list));
+
+	/* Try acquiring scheduled resources */
+	if (__run_current_acquire(cpu)) {
+		/* Succesfully acquired all the resources to make a progress! */
+		__print_event(cpu, current->pid, EVENT_RUN, 0);
+
+		/* So, it ages by one tick */
+		current->age++;
+		cpu->__nr_ran++;
+		cpu->__ran = current;
+
+		/* And performs scheduled releases */
+		__run_current_release(cpu);
+	} else if (!current->__killed && !cpu->sim->__deadlocked) {
+		/**
+		 * The current is blocked while acquiring resource(s).
+		 * In this case, @current could not make a progress in this tick
+		 */
+		__print_event(cpu, current->pid, EVENT_BLOCK, 0);
+		//dump_status(cpu->sim);
+		/* Thus, it is not get aged nor unable to perform releases */
+		cpu->__blocked = current;
+	}
+}
+
+
+/***********************************************************************
+ * The main loop for the scheduler simulation
+ */
+static void __do_simulation(struct sim *sim)
+{
+	struct scheduler *sched = sim->sched;
+
+	assert(sched->schedule && "scheduler.schedule() not implemented");
+
+	while (true) {
+		struct cpu *cpu;
+		bool busy = false;
+
+		/**
+		 * A process blocked on a CPU might have been woken up by a release
+		 * on another CPU later in the same tick. It is in the ready queue
+		 * now, so do not let it stay as the current
+		 */
+		for_each_cpu(sim, cpu) {
+			if (cpu->__blocked && cpu->__blocked == cpu->current &&
+					cpu->current->status != PROCESS_WAIT) {
+				cpu->current = NULL;
+			}
+			cpu->__blocked = NULL;
+		}
+
+		/* Fork processes on schedule */
+		__fork_on_schedule(sim);
+		if (sim->__stream && sim->__stream->failed) break;
+
+		/* Balance the load on schedule */
+		if (sim->balance != BALANCE_NONE && sim->ticks % sim->balance_interval == 0) {
+			__rebalance(sim);
+		}
+
+		for_each_cpu(sim, cpu) {
+			struct process *prev;
+
+			/* Ask scheduler to pick the next process to run */
+			prev = cpu->current;
+			cpu->current = sched->schedule(cpu);
+
+			/* The process ran in the last tick is taken off while runnable */
+			if (cpu->__ran && cpu->__ran != cpu->current &&
+					cpu->__ran->age < cpu->__ran->lifespan) {
+				cpu->__ran->__nr_preemptions++;
+			}
+			cpu->__ran = NULL;
+
+			/* If the CPU ran a process in the previous tick, */
+			if (prev) {
+				/* Update the process status */
+				if (prev->status == PROCESS_RUNNING) {
+					prev->status = PROCESS_READY;
+				}
+
+				/* Decommission it if completed */
+				if (prev->age == prev->lifespan) {
+					prev->status = PROCESS_EXIT;
+					__exit_process(prev);
+				}
+			}
+
+			/* Rather than being idle, steal some work from others */
+			if (!cpu->current && sim->balance == BALANCE_PULL && __steal_for_idle(cpu)) {
+				cpu->current = sched->schedule(cpu);
+			}
+
+			if (cpu->current || !list_empty(&cpu->readyqueue)) busy = true;
+		}
+
+		/* Quit simulation if no pending process exists */
+		if (!busy && list_empty(&sim->__forkqueue)) break;
+
+		/* Or give up the rest at the limit */
+		if (sim->max_ticks && sim->ticks >= sim->max_ticks) {
+			sim->truncated = true;
+			break;
+		}
+
+		for_each_cpu(sim, cpu) {
+			if (cpu->current) {
+				__run_current(cpu);
+			} else {
+				/* No process is ready to run at this moment. Idle temporarily */
+				__print_event(cpu, 0, EVENT_IDLE, 0);
+			}
+		}
+		if (sim->__deadlocked) break;
+
+		/* Increase the tick counter */
+		sim->ticks++;
+
+		if (sim->event_driven) __skip_to_next_event(sim);
+	}
+}
+
+
+void sim_init(struct sim *sim, struct scheduler *sched)
+{
+	memset(sim, 0x00, sizeof(*sim));
+
+	sim->sched = sched;
+	sim->nr_cpus = 1;
+	sim->balance = BALANCE_NONE;
+	sim->balance_interval = 10;
+	sim->quantum = 1;
+	sim->min_granularity = 1;
+	sim->sleeper_credit = 3;
+	sim->mlfq_levels = 3;
+	for (unsigned int i = 0; i < sim->mlfq_levels; i++) {
+		sim->mlfq_quanta[i] = 1 << i;
+	}
+	sim->mlfq_boost = 50;
+	sim->nr_resources = NR_RESOURCES;
+	sim->deadlock = DEADLOCK_ABORT;
+	sim->rw_preference = RW_PREFER_WRITERS;
+	sim->out = stdout;
+	sim->log = stderr;
+
+	INIT_LIST_HEAD(&sim->__forkqueue);
+	INIT_LIST_HEAD(&sim->__processes);
+
+	sim->__process_pool = pool_create(sizeof(struct process), NR_OBJECTS_PER_SLAB);
+	sim->__schedule_pool = pool_create(sizeof(struct resource_schedule), NR_OBJECTS_PER_SLAB);
+}
+
+int sim_run(struct sim *sim)
+{
+	struct scheduler *sched = sim->sched;
+	struct process *p;
+	unsigned int nr_initialized;
+	int ret = 0;
+
+	assert(sim->nr_cpus >= 1 && sim->nr_cpus <= MAX_NR_CPUS);
+	assert(sim->balance == BALANCE_NONE ||
+			(sched->nr_ready && sched->steal && sched->enqueue));
+
+	/* Refuse to start rather than to fail in the middle */
+	if (sched->ceilings && sim->streaming) {
+		fprintf(stderr, "%s scheduler needs the whole script for the resource "
+				"ceilings and cannot stream it\n", sched->name);
+		return -1;
+	}
+	if (!sched->acquire || !sched->release) {
+		list_for_each_entry(p, &sim->__processes, __processes) {
+			if (!__resources_supported(sim, p)) {
+				fprintf(stderr, "%s scheduler does not support resources\n", sched->name);
+				return -1;
+			}
+		}
+	}
+	list_for_each_entry(p, &sim->__processes, __processes) {
+		if (!__ceilings_supported(sim, p)) {
+			fprintf(stderr, "%s scheduler does not support multi-unit or shared "
+					"resources\n", sched->name);
+			return -1;
+		}
+	}
+
+	sim->cpus = calloc(sim->nr_cpus, sizeof(*sim->cpus));
+	assert(sim->cpus);
+
+	for (unsigned int i = 0; i < sim->nr_cpus; i++) {
+		sim->cpus[i].id = i;
+		sim->cpus[i].sim = sim;
+		INIT_LIST_HEAD(&sim->cpus[i].readyqueue);
+	}
+
+	for (nr_initialized = 0; nr_initialized < sim->nr_cpus; nr_initialized++) {
+		if (sched->initialize && (ret = sched->initialize(sim->cpus + nr_initialized))) {
+			goto out_finalize;
+		}
+	}
+
+	if (sim->events) sim->__events = event_log_create(sim->events, sim->nr_cpus);
+	if (sim->collect_metrics) sim->metrics = metrics_create();
+
+	__do_simulation(sim);
+
+	/* Nothing is left to run but the processes blocked for good */
+	if (!sim->truncated && !sim->__deadlocked && !(sim->__stream && sim->__stream->failed) &&
+			sim->deadlock != DEADLOCK_IGNORE && __stalled(sim)) {
+		__report_stalled(sim);
+		sim->__deadlocked = true;
+	}
+
+	if (sim->__events) {
+		event_log_destroy(sim->__events);
+		sim->__events = NULL;
+	}
+
+	if (sim->nr_cpus > 1 && !sim->quiet) {
+		__report_balance(sim);
+	}
+	if (sim->nr_deadlines && !sim->quiet) {
+		__report_deadlines(sim);
+	}
+	if (sim->nr_killed && !sim->quiet) {
+		fprintf(sim->out, "\n%u process%s killed to break deadlocks\n",
+				sim->nr_killed, sim->nr_killed >= 2 ? "es were" : " was");
+	}
+	if (sim->report_pools) {
+		__report_pools(sim);
+	}
+
+	ret = (sim->__stream && sim->__stream->failed) || sim->__deadlocked ? -1 : 0;
+
+out_finalize:
+	/* Only the CPUs initialized successfully have anything to finalize */
 	if (sched->finalize) {
-		sched->finalize();
+		for (unsigned int i = 0; i < nr_initialized; i++) {
+			sched->finalize(sim->cpus + i);
+		}
+	}
+	return ret;
+}
+
+void sim_destroy(struct sim *sim)
+{
+	struct process *p, *tmp;
+
+	/* Processes not forked yet or blocked forever */
+	list_for_each_entry_safe(p, tmp, &sim->__processes, __processes) {
+		__free_process(sim, p);
+	}
+
+	if (sim->metrics) {
+		metrics_destroy(sim->metrics);
+		sim->metrics = NULL;
+	}
+
+	pool_destroy(sim->__process_pool);
+	pool_destroy(sim->__schedule_pool);
+	sim->__process_pool = sim->__schedule_pool = NULL;
+
+	if (sim->__stream) {
+		__close_stream(sim->__stream);
+		free(sim->__stream);
+		sim->__stream = NULL;
+	}
+
+	if (sim->resources) {
+		for (unsigned int i = 0; i < sim->nr_resources; i++) {
+			heap_destroy(&sim->resources[i].waiters);
+			heap_destroy(&sim->resources[i].shared_waiters);
+		}
+		free(sim->resources);
+		free(sim->__blocked_on);
+		free(sim->__held_by);
+		sim->resources = NULL;
+		sim->__blocked_on = NULL;
+		sim->__held_by = NULL;
 	}
 
-	return EXIT_SUCCESS;
+	free(sim->cpus);
+	sim->cpus = NULL;
 }
 /*          ******        DO NOT MODIFY THIS FILE        ******       */
 /*====================================================================*/
@@ -16,6 +16,9 @@
 #ifndef __SCHED_H__
 #define __SCHED_H__
 
+struct cpu;
+struct process;
+
 /***********************************************************************
  * struct scheduler
  *
@@ -28,57 +31,59 @@ struct scheduler {
 	const char *name;
 
 	/***********************************************************************
-	 * int initialize(void)
+	 * int initialize(struct cpu *cpu)
 	 *
 	 * DESCRIPTION
-	 *   Call-back function for your own initialization code. It is OK to
-	 *   leave this field NULL if you don't need any initialization.
+	 *   Call-back function for your own initialization code. Called for
+	 *   each @cpu before the simulation starts. It is OK to leave this
+	 *   field NULL if you don't need any initialization.
 	 *
 	 * RETURN VALUE
 	 *   Return 0 on successful initialization.
 	 *   Return other value on error, which leads the program to exit.
 	 */
-	int (*initialize)(void);
+	int (*initialize)(struct cpu *);
 
 
 	/***********************************************************************
-	 * void finalize(void)
+	 * void finalize(struct cpu *cpu)
 	 *
 	 * DESCRIPTION
-	 *   Callback function for finalizing your code. Like @initialize(),
-	 *   you may leave this function NULL.
+	 *   Callback function for finalizing your code for each @cpu. Like
+	 *   @initialize(), you may leave this function NULL.
 	 */
-	void (*finalize)(void);
+	void (*finalize)(struct cpu *);
 
 
 	/***********************************************************************
-	 * void fork(struct process *process)
+	 * void fork(struct cpu *cpu, struct process *process)
 	 *
 	 * DESCRIPTION
-	 *   Called when @process is newly forked. You may do per-process
+	 *   Called when @process is newly forked and put into the ready queue
+	 *   of @cpu. You may do per-process
 	 *   initialization work in this function. You may leave this function
 	 *   NULL if you don't need it.
 	 */
-	void (*forked)(struct process *);
+	void (*forked)(struct cpu *, struct process *);
 
 
 	/***********************************************************************
-	 * void exiting(struct process *process)
+	 * void exiting(struct cpu *cpu, struct process *process)
 	 *
 	 * DESCRIPTION
-	 *   Called when @process is about to exit. You may do per-process
+	 *   Called when @process is about to exit on @cpu. You may do per-process
 	 *   finalization work in this function. You may leave this function NULL
 	 *   if you don't need it.
 	 */
-	void (*exiting)(struct process *);
+	void (*exiting)(struct cpu *, struct process *);
 
 
 	/***********************************************************************
-	 * struct process *schedule(void)
+	 * struct process *schedule(struct cpu *cpu)
 	 *
 	 * DESCRIPTION
-	 *   Pick a process to run next. @current points to the current process
-	 *   which has been running on the processor. You may put the current
+	 *   Pick a process to run next on @cpu. @cpu->current points to the
+	 *   current process which has been running on @cpu. You may put the current
 	 *   into the ready queue and pick a process to run next if the current is
 	 *   ready status. When the current is blocked (i.e., waiting for some
 	 *   resources), however, you should not put it back into the ready queue
@@ -88,29 +93,102 @@ struct scheduler {
 	 *   process to run next
 	 *   NULL if there is no available process to schedule
 	 */
-	struct process *(*schedule)(void);
+	struct process *(*schedule)(struct cpu *);
 
 
 	/***********************************************************************
-	 * bool acquire(int resource_id)
+	 * bool acquire(struct cpu *cpu, int resource_id)
 	 *
 	 * DESCRIPTION
-	 *   Callback function to acquire the resource @resource_id.
+	 *   Callback function for @cpu->current to acquire the resource
+	 *   @resource_id. It is acquired in the shared mode if
+	 *   @cpu->current->shared is set, and exclusively otherwise.
 	 *
 	 * RETURN
 	 *   true on successful acquision
 	 *   false if the resource is already held by others or unavailable
 	 */
-	bool (*acquire)(int);
+	bool (*acquire)(struct cpu *, int);
+
+
+	/***********************************************************************
+	 * void release(struct cpu *cpu, int resource_id)
+	 *
+	 * DESCRIPTION
+	 *   Callbacked for @cpu->current to release the resource @resource_id
+	 *   held in the mode of @cpu->current->shared. The processes woken up
+	 *   should go to the runqueue of their own CPUs
+	 */
+	void (*release)(struct cpu *, int);
+
+
+	/***********************************************************************
+	 * unsigned int timeslice(struct cpu *cpu)
+	 *
+	 * DESCRIPTION
+	 *   Tell how many more ticks @cpu->current would be picked again by
+	 *   schedule() if nothing happens in the meantime; i.e., no process is
+	 *   forked, @current neither acquires nor releases a resource, and it
+	 *   does not exit. The event-driven simulation runs @current for that
+	 *   many ticks without calling schedule(). Leave this function NULL to
+	 *   have schedule() called on every tick.
+	 *
+	 * RETURN
+	 *   Number of ticks, UINT_MAX if @current can run until the next event
+	 *   0 or 1 if schedule() should be called on the next tick
+	 */
+	unsigned int (*timeslice)(struct cpu *);
+
+
+	/***********************************************************************
+	 * unsigned int nr_ready(struct cpu *cpu)
+	 *
+	 * DESCRIPTION
+	 *   Tell how many processes are waiting to run on @cpu. @cpu->current
+	 *   is not counted. The load balancer compares CPUs with this.
+	 *
+	 * RETURN
+	 *   Number of processes in the runqueue of @cpu
+	 */
+	unsigned int (*nr_ready)(struct cpu *);
+
+
+	/***********************************************************************
+	 * struct process *steal(struct cpu *cpu)
+	 *
+	 * DESCRIPTION
+	 *   Detach a ready process from the tail of the runqueue of @cpu so that
+	 *   the load balancer can migrate it to another CPU. Pick the one that
+	 *   would run last on @cpu. Leave this function NULL to disable load
+	 *   balancing.
+	 *
+	 * RETURN
+	 *   The process detached from the runqueue
+	 *   NULL if @cpu has no process to give away
+	 */
+	struct process *(*steal)(struct cpu *);
+
+
+	/***********************************************************************
+	 * void enqueue(struct cpu *cpu, struct process *process)
+	 *
+	 * DESCRIPTION
+	 *   Put @process migrated from another CPU into the runqueue of @cpu.
+	 *   @process->cpu is already @cpu when this is called.
+	 */
+	void (*enqueue)(struct cpu *, struct process *);
 
 
 	/***********************************************************************
-	 * void release(int resource_id)
+	 * bool ceilings
 	 *
 	 * DESCRIPTION
-	 *   Callbacked to release the resource @resource_id
+	 *   Set if acquire() relies on @resource->ceiling, the highest priority
+	 *   of the processes acquiring the resource. The ceilings are complete
+	 *   only once the whole script is loaded, so such a scheduler cannot
+	 *   run a streamed script.
 	 */
-	void (*release)(int);
+	bool ceilings;
 };
 
 #endif
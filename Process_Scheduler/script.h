@@ -0,0 +1,65 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SCRIPT_H__
+#define __SCRIPT_H__
+
+/**
+ * Binary process script. The file is a header followed by an array of
+ * process records, an array of resource schedule records, and an array of
+ * capacity records for the resources of more than one unit. Each process
+ * record refers to its resource schedules as a range of the second array,
+ * so the loader maps the file and walks the arrays without any parsing.
+ * All fields are in the byte order of the host that wrote the file.
+ */
+#define SCRIPT_MAGIC		"SCHEDBIN"
+#define SCRIPT_MAGIC_LEN	8
+#define SCRIPT_VERSION		1
+
+struct script_header {
+	char magic[SCRIPT_MAGIC_LEN];	/* SCRIPT_MAGIC without the trailing NUL */
+	uint32_t version;
+	uint32_t nr_processes;
+	uint32_t nr_schedules;
+	uint32_t nr_capacities;
+};
+
+struct script_process {
+	uint32_t pid;
+	uint32_t start;
+	uint32_t lifespan;
+	uint32_t prio;
+	uint32_t first_schedule;	/* Index of the first resource schedule */
+	uint32_t nr_schedules;		/* # of resource schedules of the process */
+	uint32_t deadline;		/* Ticks after @start to exit by. UINT32_MAX for none */
+	uint32_t period;		/* Ticks between the jobs of a periodic process */
+	uint32_t nr_jobs;		/* # of jobs to release. 1 for an aperiodic process */
+};
+
+struct script_schedule {
+	int32_t resource_id;
+	int32_t at;
+	int32_t duration;
+	uint32_t flags;			/* SCRIPT_SHARED to acquire in the shared mode */
+};
+
+#define SCRIPT_SHARED		0x1
+
+struct script_capacity {
+	int32_t resource_id;
+	uint32_t capacity;		/* # of units of the resource */
+};
+
+#endif
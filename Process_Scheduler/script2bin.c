@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/**
+ * Convert a process script into the binary format of script.h so that
+ * large scripts can be mapped into the simulator rather than parsed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "resource.h"
+#include "sim.h"
+
+int main(int argc, char * const argv[])
+{
+	struct sim sim;
+	int opt;
+	int ret;
+
+	sim_init(&sim, NULL);
+	sim.quiet = true;
+
+	while ((opt = getopt(argc, argv, "N:")) != -1) {
+		if (opt != 'N' || atoi(optarg) < 1 || atoi(optarg) > MAX_NR_RESOURCES) {
+			optind = argc;
+			break;
+		}
+		sim.nr_resources = atoi(optarg);
+	}
+
+	if (argc - optind != 2) {
+		printf("Usage: %s {-N resources} [process script file] [binary script file]\n", argv[0]);
+		sim_destroy(&sim);
+		return EXIT_FAILURE;
+	}
+
+	ret = sim_load_script(&sim, argv[optind]);
+	if (!ret) {
+		ret = sim_save_script(&sim, argv[optind + 1]);
+	}
+
+	sim_destroy(&sim);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+struct cpu;
+struct scheduler;
+struct script_stream;
+struct pool;
+struct event_log;
+struct metrics;
+
+/**
+ * Maximum number of levels of the multi-level feedback queue
+ */
+#define MAX_MLFQ_LEVELS	8
+
+/**
+ * How to balance the load across the CPUs. Idle CPUs steal processes from
+ * busy ones only with pulling, and the load is evened out every
+ * @balance_interval ticks with either strategy
+ */
+enum balance_strategy {
+	BALANCE_NONE,
+	BALANCE_PULL,
+	BALANCE_PUSH,
+};
+
+/**
+ * What to do when a process is about to wait for a resource held by a
+ * process that waits for it in turn, directly or through others. The cycle
+ * is reported, and then the simulation is stopped or the process closing
+ * the cycle is killed, giving back the resources it holds
+ */
+enum deadlock_policy {
+	DEADLOCK_ABORT,
+	DEADLOCK_KILL,
+	DEADLOCK_IGNORE,
+};
+
+/**
+ * Who goes first on a resource held in the shared mode. Readers may join
+ * the readers holding it while writers wait with RW_PREFER_READERS, whereas
+ * a waiting writer holds the new readers back with RW_PREFER_WRITERS.
+ * Either way, the readers waiting are woken up all together
+ */
+enum rw_preference {
+	RW_PREFER_WRITERS,
+	RW_PREFER_READERS,
+};
+
+/***********************************************************************
+ * struct sim
+ *
+ * DESCRIPTION
+ *   A scheduler simulation. Everything a simulation changes lives here,
+ *   so independent simulations can be run one after another or side by
+ *   side in a process. Scheduler callbacks reach it through @cpu->sim.
+ */
+struct sim {
+	/**
+	 * Configurations. Set them up after sim_init() and before loading
+	 * the script
+	 */
+	struct scheduler *sched;	/* Scheduler to simulate */
+	unsigned int nr_cpus;		/* # of CPUs to simulate */
+	unsigned int nr_resources;	/* # of resources in the system */
+	bool quiet;			/* Do not print the briefing and report */
+	bool event_driven;		/* Skip the ticks without events */
+	enum balance_strategy balance;	/* How to balance the load across the CPUs */
+	unsigned int balance_interval;	/* Balance the load every this many ticks */
+	unsigned int quantum;		/* Time quantum of the round-robin scheduler */
+	unsigned int min_granularity;	/* Ticks the fair scheduler runs a process at least */
+	unsigned int sleeper_credit;	/* Ticks of virtual runtime the fair scheduler credits
+					   the processes waking up from resource waits */
+	unsigned int mlfq_levels;	/* # of levels of the multi-level feedback queue */
+	unsigned int mlfq_quanta[MAX_MLFQ_LEVELS];
+					/* Time quantum of each level from the top */
+	unsigned int mlfq_boost;	/* Move every process to the top level every this
+					   many ticks. 0 not to */
+	unsigned int max_ticks;		/* Stop the simulation at this tick. 0 for no limit */
+	enum deadlock_policy deadlock;	/* What to do on deadlocks */
+	enum rw_preference rw_preference;
+					/* Who goes first on shared resources */
+	bool streaming;			/* Read the processes just before they are forked */
+	bool report_pools;		/* Report the usage of the object pools at the end */
+	bool collect_metrics;		/* Record the completed processes in @metrics */
+	FILE *out;			/* Where to print the briefing and report */
+	FILE *log;			/* Where to log the events. NULL to log nothing */
+	FILE *events;			/* Where to write the events in the binary format of
+					   event_log.h. NULL not to write them */
+
+	/**
+	 * Number of generated ticks since the simulation was started
+	 */
+	unsigned int ticks;
+
+	/**
+	 * Set if the simulation is stopped at @max_ticks with processes left to
+	 * run. The statistics below cover only the processes exited by then
+	 */
+	bool truncated;
+
+	/**
+	 * Simulated processors. @nr_cpus of them
+	 */
+	struct cpu *cpus;
+
+	/**
+	 * Statistics over the processes. A process arrives when it is forked,
+	 * and it waits while it is forked but not running
+	 */
+	unsigned int nr_processes;		/* # of processes loaded */
+	unsigned int nr_exited;			/* # of processes exited */
+	unsigned long long total_turnaround;	/* Sum of ticks from arrival to exit */
+	unsigned long long total_waiting;	/* Sum of ticks spent not running */
+	unsigned long long total_response;	/* Sum of ticks from arrival to the first run */
+
+	/**
+	 * Statistics over the processes exited with a deadline. A process is
+	 * late by the ticks it exits after its deadline
+	 */
+	unsigned int nr_deadlines;		/* # of processes exited with a deadline */
+	unsigned int nr_missed;			/* # of them exited after the deadline */
+	unsigned long long total_lateness;	/* Sum of the lateness of them */
+	unsigned int max_lateness;		/* Maximum lateness among them */
+
+	/**
+	 * # of processes killed to break deadlocks. They are not counted in
+	 * the statistics above
+	 */
+	unsigned int nr_killed;
+
+	/**
+	 * Records of the completed processes with @collect_metrics. Valid
+	 * until sim_destroy()
+	 */
+	struct metrics *metrics;
+
+	/**
+	 * Resources in the system. @nr_resources of them, allocated as the
+	 * script is loaded
+	 */
+	struct resource *resources;
+
+	/** DO NOT ACCESS FOLLOWING VARIABLES **/
+	struct list_head __forkqueue;	/* Processes to fork sorted by the forking time */
+	struct list_head __processes;	/* Processes loaded and not exited yet */
+	unsigned int __nr_forked;	/* # of processes forked so far */
+	struct pool *__process_pool;	/* Where the processes are allocated */
+	struct pool *__schedule_pool;	/* Where the resource schedules are allocated */
+	struct event_log *__events;	/* Buffer for the binary event log */
+	struct list_head *__blocked_on;	/* Processes blocked on each resource with @metrics */
+	struct list_head *__held_by;	/* Schedules holding each resource */
+	unsigned int __nr_searches;	/* # of deadlock searches so far */
+	struct script_stream *__stream;	/* Script being read in the streaming mode */
+	bool __deadlocked;		/* Stopped on a deadlock */
+};
+
+#define for_each_cpu(sim, cpu) \
+	for (cpu = (sim)->cpus; cpu < (sim)->cpus + (sim)->nr_cpus; cpu++)
+
+
+/***********************************************************************
+ * sim_init()
+ *
+ * DESCRIPTION
+ *   Initialize @sim to simulate @sched on a CPU. Events are logged to
+ *   stderr, and the briefing and report go to stdout.
+ */
+void sim_init(struct sim *sim, struct scheduler *sched);
+
+
+/***********************************************************************
+ * sim_load_script()
+ *
+ * DESCRIPTION
+ *   Load the processes described in @filename into @sim. The script is
+ *   either in the text format or in the binary format of script.h, which
+ *   is told by its magic.
+ *
+ *   A resource may be given a number of units in the script, so that as
+ *   many processes can hold it at a time. The resource ids in the script
+ *   should be less than @sim->nr_resources. An acquire ending with "shared"
+ *   holds the resource together with the other readers, and is served as
+ *   @sim->rw_preference tells.
+ *
+ *   A process may be given a deadline in ticks after its forking. A
+ *   periodic process releases its jobs as separate processes every period,
+ *   and each job is due by the deadline after its release; one period if
+ *   not given. Jobs are queued one at a time as the previous one is forked.
+ *
+ *   With @sim->streaming, only the script is opened here. The processes
+ *   are read one by one just before they are forked and are freed as they
+ *   exit, so the memory in use is bounded by the live processes rather
+ *   than by the script. The script should be sorted by the forking time,
+ *   and the processes are not briefed.
+ *
+ * RETURN
+ *   0 on success
+ *   -1 if the script cannot be read or is malformed
+ */
+int sim_load_script(struct sim *sim, const char *filename);
+
+
+/***********************************************************************
+ * sim_save_script()
+ *
+ * DESCRIPTION
+ *   Write the processes loaded into @sim to @filename in the binary
+ *   format. Call it before sim_run() as running consumes the processes.
+ *
+ * RETURN
+ *   0 on success
+ *   -1 if @filename cannot be written
+ */
+int sim_save_script(struct sim *sim, const char *filename);
+
+
+/***********************************************************************
+ * sim_run()
+ *
+ * DESCRIPTION
+ *   Run the simulation until no process is left to run. To balance the
+ *   load, @sim->sched should implement nr_ready(), steal(), and enqueue().
+ *
+ *   The priority protocols boost the owner of a resource, so they cover
+ *   only the single-unit resources held exclusively. The priority
+ *   inheritance serves the others in the priority order without any
+ *   donation, and the priority ceiling refuses the scripts acquiring them.
+ *
+ *   Deadlocks are caught as a process is about to wait for a resource,
+ *   and are dealt with as @sim->deadlock tells. A waiter is blocked by
+ *   every holder it needs to leave, including the readers of a shared
+ *   resource. A writer waiting for a multi-unit resource held by writers
+ *   is not followed as any of them may give a unit back, so a cycle
+ *   through such resources is only found at the end, when nothing but
+ *   the blocked processes is left. It cannot be broken by then, and is
+ *   reported as a deadlock unless with DEADLOCK_IGNORE.
+ *
+ * RETURN
+ *   0 on success
+ *   Other value if the scheduler fails to initialize, does not support
+ *   the resources the processes acquire, or cannot run a streamed script,
+ *   if a streamed script turns out to be unsorted, if processes deadlock
+ *   with DEADLOCK_ABORT, or if they are left blocked for good with
+ *   DEADLOCK_KILL
+ */
+int sim_run(struct sim *sim);
+
+
+/***********************************************************************
+ * sim_destroy()
+ *
+ * DESCRIPTION
+ *   Free everything @sim has allocated including the processes left
+ *   unfinished
+ */
+void sim_destroy(struct sim *sim);
+
+#endif
@@ -0,0 +1,422 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/**
+ * Run the simulations for every combination of the scripts, schedulers,
+ * and round-robin quanta in parallel, and tabulate the results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "resource.h"
+#include "prio_array.h"
+#include "cpu.h"
+#include "sim.h"
+#include "metrics.h"
+
+#include "sched.h"
+
+extern struct scheduler fifo_scheduler;
+extern struct scheduler sjf_scheduler;
+extern struct scheduler srtf_scheduler;
+extern struct scheduler rr_scheduler;
+extern struct scheduler prio_scheduler;
+extern struct scheduler pa_scheduler;
+extern struct scheduler pcp_scheduler;
+extern struct scheduler pip_scheduler;
+extern struct scheduler fair_scheduler;
+extern struct scheduler mlfq_scheduler;
+extern struct scheduler edf_scheduler;
+extern struct scheduler stride_scheduler;
+extern struct scheduler lottery_scheduler;
+
+/**
+ * Schedulers to choose from, with the same letters as sched uses
+ */
+static struct policy {
+	char opt;
+	const char *name;
+	struct scheduler *sched;
+	bool quantum;		/* Swept over the quanta */
+} policies[] = {
+	{ 'f', "fifo", &fifo_scheduler, false },
+	{ 's', "sjf", &sjf_scheduler, false },
+	{ 'S', "srtf", &srtf_scheduler, false },
+	{ 'r', "rr", &rr_scheduler, true },
+	{ 'p', "prio", &prio_scheduler, false },
+	{ 'a', "pa", &pa_scheduler, false },
+	{ 'c', "pcp", &pcp_scheduler, false },
+	{ 'i', "pip", &pip_scheduler, false },
+	{ 'F', "cfs", &fair_scheduler, false },
+	{ 'L', "mlfq", &mlfq_scheduler, false },
+	{ 'd', "edf", &edf_scheduler, false },
+	{ 'x', "stride", &stride_scheduler, false },
+	{ 'y', "lotto", &lottery_scheduler, false },
+};
+
+#define NR_POLICIES	(sizeof(policies) / sizeof(policies[0]))
+
+#define MAX_NR_QUANTA	32
+
+/**
+ * A simulation to run and its result
+ */
+struct job {
+	const char *script;
+	struct policy *policy;
+	unsigned int quantum;
+
+	int ret;
+	bool truncated;		/* Given up at @max_ticks */
+	unsigned int nr_processes;
+	unsigned int nr_exited;
+	unsigned int ticks;
+	double turnaround;
+	double waiting;
+	double response;
+	struct metrics_summary percentiles[METRIC_RESPONSE + 1];
+	unsigned int nr_deadlines;
+	unsigned int nr_missed;
+	double lateness;
+	unsigned int max_lateness;
+};
+
+static struct job *jobs;
+static unsigned int nr_jobs = 0;
+static unsigned int next_job = 0;
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Simulation settings shared by all jobs
+ */
+static unsigned int nr_cpus = 1;
+static unsigned int nr_resources = NR_RESOURCES;
+static enum deadlock_policy deadlock = DEADLOCK_ABORT;
+static enum rw_preference rw_preference = RW_PREFER_WRITERS;
+static bool event_driven = false;
+static bool streaming = false;
+static unsigned int max_ticks = 10000000;
+
+
+static void __run_job(struct job *job)
+{
+	struct sim sim;
+
+	sim_init(&sim, job->policy->sched);
+	sim.quiet = true;
+	sim.log = NULL;
+	sim.nr_cpus = nr_cpus;
+	sim.nr_resources = nr_resources;
+	sim.deadlock = deadlock;
+	sim.rw_preference = rw_preference;
+	sim.event_driven = event_driven;
+	sim.streaming = streaming;
+	sim.collect_metrics = true;
+	sim.max_ticks = max_ticks;
+	if (job->quantum) sim.quantum = job->quantum;
+
+	job->ret = sim_load_script(&sim, job->script);
+	if (!job->ret) {
+		job->ret = sim_run(&sim);
+	}
+
+	job->truncated = sim.truncated;
+	job->nr_processes = sim.nr_processes;
+	job->nr_exited = sim.nr_exited;
+	job->ticks = sim.ticks;
+	if (sim.nr_exited) {
+		job->turnaround = (double)sim.total_turnaround / sim.nr_exited;
+		job->waiting = (double)sim.total_waiting / sim.nr_exited;
+		job->response = (double)sim.total_response / sim.nr_exited;
+	}
+	job->nr_deadlines = sim.nr_deadlines;
+	job->nr_missed = sim.nr_missed;
+	job->max_lateness = sim.max_lateness;
+	if (sim.nr_missed) {
+		job->lateness = (double)sim.total_lateness / sim.nr_missed;
+	}
+	if (sim.metrics) {
+		for (int i = METRIC_TURNAROUND; i <= METRIC_RESPONSE; i++) {
+			metrics_summarize(sim.metrics, i, job->percentiles + i);
+		}
+	}
+
+	sim_destroy(&sim);
+}
+
+static void *__worker(void *arg)
+{
+	(void)arg;
+
+	while (true) {
+		unsigned int i;
+
+		pthread_mutex_lock(&jobs_lock);
+		i = next_job++;
+		pthread_mutex_unlock(&jobs_lock);
+
+		if (i >= nr_jobs) break;
+
+		__run_job(jobs + i);
+	}
+	return NULL;
+}
+
+static void __print_results(void)
+{
+	printf("%-24s %-6s %7s %6s %6s %10s %11s %10s %10s\n",
+			"Script", "Policy", "Quantum", "Procs", "Exited", "Ticks",
+			"Turnaround", "Waiting", "Response");
+
+	for (unsigned int i = 0; i < nr_jobs; i++) {
+		struct job *job = jobs + i;
+		char quantum[16] = "-";
+
+		if (job->quantum) snprintf(quantum, sizeof(quantum), "%u", job->quantum);
+
+		printf("%-24s %-6s %7s ", job->script, job->policy->name, quantum);
+		if (job->ret) {
+			printf("%6s\n", "error");
+			continue;
+		}
+		if (job->truncated) {
+			printf("%6s at tick %u with %u of %u processes exited\n", "truncated",
+					job->ticks, job->nr_exited, job->nr_processes);
+			continue;
+		}
+		printf("%6u %6u %10u %11.2f %10.2f %10.2f\n",
+				job->nr_processes, job->nr_exited, job->ticks,
+				job->turnaround, job->waiting, job->response);
+	}
+
+	printf("\n");
+	printf("%-24s %-6s %7s   %26s  %26s  %26s\n", "", "", "",
+			"Turnaround p50/p95/p99", "Waiting p50/p95/p99", "Response p50/p95/p99");
+	for (unsigned int i = 0; i < nr_jobs; i++) {
+		struct job *job = jobs + i;
+		char quantum[16] = "-";
+
+		if (job->ret || job->truncated) continue;
+		if (job->quantum) snprintf(quantum, sizeof(quantum), "%u", job->quantum);
+
+		printf("%-24s %-6s %7s ", job->script, job->policy->name, quantum);
+		for (int m = METRIC_TURNAROUND; m <= METRIC_RESPONSE; m++) {
+			struct metrics_summary *s = job->percentiles + m;
+			printf("  %8u %8u %8u", s->p50, s->p95, s->p99);
+		}
+		printf("\n");
+	}
+
+	for (unsigned int i = 0; i < nr_jobs; i++) {
+		if (!jobs[i].ret && !jobs[i].truncated && jobs[i].nr_deadlines) break;
+		if (i == nr_jobs - 1) return;
+	}
+
+	printf("\n");
+	printf("%-24s %-6s %7s %9s %6s %8s %8s\n", "", "", "",
+			"Deadlines", "Missed", "Lateness", "Max");
+	for (unsigned int i = 0; i < nr_jobs; i++) {
+		struct job *job = jobs + i;
+		char quantum[16] = "-";
+
+		if (job->ret || job->truncated || !job->nr_deadlines) continue;
+		if (job->quantum) snprintf(quantum, sizeof(quantum), "%u", job->quantum);
+
+		printf("%-24s %-6s %7s %9u %6u %8.2f %8u\n", job->script, job->policy->name,
+				quantum, job->nr_deadlines, job->nr_missed, job->lateness, job->max_lateness);
+	}
+}
+
+static struct policy *__find_policy(char opt)
+{
+	for (unsigned int i = 0; i < NR_POLICIES; i++) {
+		if (policies[i].opt == opt) return policies + i;
+	}
+	return NULL;
+}
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-j threads} {-p policies} {-Q quanta} {-n cpus} {-N resources} {-D abort|kill|ignore} {-W writers|readers} {-e} {-l} {-t ticks} [process script file]...\n", name);
+	printf("\n");
+	printf("  -j: Run @threads simulations at a time (# of online CPUs by default)\n");
+	printf("  -p: Schedulers to run in the letters of sched (fsSrpaciFLdxy by default)\n");
+	printf("  -Q: Comma-separated time quanta for the round-robin scheduler (1 by default)\n");
+	printf("  -n: Simulate @cpus processors\n");
+	printf("  -N: Simulate @resources resources (%d by default)\n", NR_RESOURCES);
+	printf("  -D: On a deadlock, [abort] the simulation (default), [kill] the process closing\n");
+	printf("      the cycle, or [ignore] it\n");
+	printf("  -W: Let the [writers] (default) or the [readers] go first on shared resources\n");
+	printf("  -e: Skip the ticks without events (event-driven simulation)\n");
+	printf("  -l: Stream the scripts sorted by the forking time in bounded memory\n");
+	printf("  -t: Give up a simulation at @ticks ticks (%u by default, 0 for no limit)\n", max_ticks);
+	printf("\n");
+	printf("Exit with failure if any simulation fails or is given up\n");
+	printf("\n");
+}
+
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	long nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *policy_opts = "fsSrpaciFLdxy";
+	unsigned int quanta[MAX_NR_QUANTA] = { 1 };
+	unsigned int nr_quanta = 1;
+	pthread_t *threads;
+	int ret = EXIT_SUCCESS;
+
+	while ((opt = getopt(argc, argv, "j:p:Q:n:N:D:W:elt:h")) != -1) {
+		switch (opt) {
+		case 'j':
+			nr_threads = atoi(optarg);
+			break;
+		case 'p':
+			policy_opts = optarg;
+			break;
+		case 'Q': {
+			char *token = strtok(optarg, ",");
+			nr_quanta = 0;
+			while (token && nr_quanta < MAX_NR_QUANTA) {
+				if (atoi(token) < 1) {
+					__print_usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				quanta[nr_quanta++] = atoi(token);
+				token = strtok(NULL, ",");
+			}
+			break;
+		}
+		case 'n':
+			if (atoi(optarg) < 1 || atoi(optarg) > MAX_NR_CPUS) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			nr_cpus = atoi(optarg);
+			break;
+		case 'N':
+			if (atoi(optarg) < 1 || atoi(optarg) > MAX_NR_RESOURCES) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			nr_resources = atoi(optarg);
+			break;
+		case 'D':
+			if (strcmp(optarg, "abort") == 0) {
+				deadlock = DEADLOCK_ABORT;
+			} else if (strcmp(optarg, "kill") == 0) {
+				deadlock = DEADLOCK_KILL;
+			} else if (strcmp(optarg, "ignore") == 0) {
+				deadlock = DEADLOCK_IGNORE;
+			} else {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'W':
+			if (strcmp(optarg, "writers") == 0) {
+				rw_preference = RW_PREFER_WRITERS;
+			} else if (strcmp(optarg, "readers") == 0) {
+				rw_preference = RW_PREFER_READERS;
+			} else {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'e':
+			event_driven = true;
+			break;
+		case 'l':
+			streaming = true;
+			break;
+		case 't':
+			max_ticks = atoi(optarg);
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc || nr_quanta == 0) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (nr_threads < 1) nr_threads = 1;
+
+	for (const char *c = policy_opts; *c; c++) {
+		if (!__find_policy(*c)) {
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Lay out the jobs in the order to report */
+	jobs = malloc(sizeof(*jobs) * (argc - optind) * strlen(policy_opts) * nr_quanta);
+	if (!jobs) return EXIT_FAILURE;
+
+	for (int i = optind; i < argc; i++) {
+		for (const char *c = policy_opts; *c; c++) {
+			struct policy *policy = __find_policy(*c);
+
+			for (unsigned int q = 0; q < (policy->quantum ? nr_quanta : 1); q++) {
+				struct job *job = jobs + nr_jobs++;
+
+				memset(job, 0x00, sizeof(*job));
+				job->script = argv[i];
+				job->policy = policy;
+				job->quantum = policy->quantum ? quanta[q] : 0;
+			}
+		}
+	}
+
+	if (nr_threads > nr_jobs) nr_threads = nr_jobs;
+
+	threads = malloc(sizeof(*threads) * nr_threads);
+	if (!threads) return EXIT_FAILURE;
+
+	for (long i = 0; i < nr_threads; i++) {
+		if (pthread_create(threads + i, NULL, __worker, NULL)) {
+			fprintf(stderr, "Cannot create a worker thread\n");
+			return EXIT_FAILURE;
+		}
+	}
+	for (long i = 0; i < nr_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	__print_results();
+
+	/* Fail if any simulation did not run to the end */
+	for (unsigned int i = 0; i < nr_jobs; i++) {
+		if (jobs[i].ret || jobs[i].truncated) ret = EXIT_FAILURE;
+	}
+
+	free(threads);
+	free(jobs);
+
+	return ret;
+}
@@ -0,0 +1,175 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+
+#include "timer_wheel.h"
+
+static inline struct list_head *__slot(struct timer_wheel *wheel, unsigned int level, unsigned int index)
+{
+	return &wheel->slots[level * WHEEL_SIZE + index];
+}
+
+static inline unsigned int __index(unsigned int time, unsigned int level)
+{
+	return (time >> (level * WHEEL_BITS)) & WHEEL_MASK;
+}
+
+/**
+ * Link @timer to the slot for its expiry time. The slot is kept sorted by
+ * the order the timers are added
+ */
+static void __place(struct timer_wheel *wheel, struct timer *timer)
+{
+	unsigned long long delta = timer->expires - wheel->now;
+	unsigned long long span = WHEEL_SIZE;
+	unsigned int level = 0;
+	struct list_head *slot, *pos;
+
+	while (delta >= span) {
+		level++;
+		span <<= WHEEL_BITS;
+	}
+	assert(level < wheel->nr_levels && "timer beyond the horizon");
+
+	slot = __slot(wheel, level, __index(timer->expires, level));
+	list_for_each_prev(pos, slot) {
+		if (list_entry(pos, struct timer, list)->seq < timer->seq) break;
+	}
+	list_add(&timer->list, pos);
+}
+
+/**
+ * Bring down the timers in the upper levels whose slot has come. Called
+ * when @wheel->now crosses the boundary of the level-0 slots
+ */
+static void __cascade(struct timer_wheel *wheel)
+{
+	for (unsigned int level = 1; level < wheel->nr_levels; level++) {
+		unsigned int index = __index(wheel->now, level);
+		LIST_HEAD(timers);
+		struct timer *timer, *tmp;
+
+		list_splice_init(__slot(wheel, level, index), &timers);
+		list_for_each_entry_safe(timer, tmp, &timers, list) {
+			list_del(&timer->list);
+			__place(wheel, timer);
+		}
+
+		if (index) break;
+	}
+}
+
+struct timer_wheel *timer_wheel_create(unsigned int horizon)
+{
+	struct timer_wheel *wheel;
+	unsigned int nr_levels = 1;
+	unsigned long long span = WHEEL_SIZE;
+
+	while (span < horizon) {
+		nr_levels++;
+		span <<= WHEEL_BITS;
+	}
+
+	wheel = malloc(sizeof(*wheel) + sizeof(struct list_head) * nr_levels * WHEEL_SIZE);
+	assert(wheel);
+
+	wheel->now = 0;
+	wheel->nr_levels = nr_levels;
+	wheel->seq = 0;
+	for (unsigned int i = 0; i < nr_levels * WHEEL_SIZE; i++) {
+		INIT_LIST_HEAD(&wheel->slots[i]);
+	}
+	return wheel;
+}
+
+void timer_wheel_destroy(struct timer_wheel *wheel)
+{
+	free(wheel);
+}
+
+void timer_wheel_add(struct timer_wheel *wheel, struct timer *timer, unsigned int expires)
+{
+	timer->expires = expires;
+	timer->seq = wheel->seq++;
+
+	if (expires < wheel->now) {
+		INIT_LIST_HEAD(&timer->list);
+		return;
+	}
+	__place(wheel, timer);
+}
+
+void timer_wheel_del(struct timer_wheel *wheel, struct timer *timer)
+{
+	(void)wheel;
+
+	list_del_init(&timer->list);
+}
+
+void timer_wheel_advance(struct timer_wheel *wheel, unsigned int now)
+{
+	while (wheel->now < now) {
+		unsigned int boundary = (wheel->now | WHEEL_MASK) + 1;
+
+		if (boundary > now) {
+			wheel->now = now;
+			break;
+		}
+		wheel->now = boundary;
+		__cascade(wheel);
+	}
+}
+
+struct timer *timer_wheel_first_due(struct timer_wheel *wheel)
+{
+	struct timer *timer;
+
+	list_for_each_entry(timer, __slot(wheel, 0, __index(wheel->now, 0)), list) {
+		if (timer->expires == wheel->now) return timer;
+	}
+	return NULL;
+}
+
+unsigned int timer_wheel_next_expiry(struct timer_wheel *wheel)
+{
+	unsigned int next = UINT_MAX;
+
+	for (unsigned int level = 0; level < wheel->nr_levels; level++) {
+		/**
+		 * The slot for @now in the upper levels holds the timers that have
+		 * wrapped around the level. So, look at it last
+		 */
+		unsigned int index = __index(wheel->now, level) + (level ? 1 : 0);
+
+		for (unsigned int i = 0; i < WHEEL_SIZE; i++) {
+			struct list_head *slot = __slot(wheel, level, (index + i) & WHEEL_MASK);
+			struct timer *timer;
+
+			if (list_empty(slot)) continue;
+
+			list_for_each_entry(timer, slot, list) {
+				if (timer->expires < next) next = timer->expires;
+			}
+			break;
+		}
+	}
+	return next;
+}
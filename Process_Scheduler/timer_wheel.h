@@ -0,0 +1,124 @@
+/**********************************************************************
+ * Copyright (c) 2019-2021
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+struct list_head;
+
+#define WHEEL_BITS	4
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+
+/***********************************************************************
+ * struct timer
+ *
+ * DESCRIPTION
+ *   Embed this into the structure to be timed, and get back to the
+ *   structure with container_of(). Timers expiring at the same time are
+ *   fired in the order they are added.
+ */
+struct timer {
+	struct list_head list;
+	unsigned int expires;
+	unsigned long long seq;
+};
+
+
+/***********************************************************************
+ * struct timer_wheel
+ *
+ * DESCRIPTION
+ *   Hierarchical timer wheel. Level 0 has a slot for each of the next
+ *   WHEEL_SIZE time units, and a slot in level L covers WHEEL_SIZE^L time
+ *   units. Timers in upper levels cascade down as @now advances, so that
+ *   the level-0 slot for @now holds exactly the timers expiring at @now.
+ *   The number of levels is chosen to cover the horizon given on creation.
+ */
+struct timer_wheel {
+	unsigned int now;
+	unsigned int nr_levels;
+	unsigned long long seq;
+	struct list_head slots[];
+};
+
+
+/***********************************************************************
+ * timer_wheel_create()
+ *
+ * DESCRIPTION
+ *   Create a timer wheel starting from time 0 which can hold timers
+ *   expiring before @horizon
+ */
+struct timer_wheel *timer_wheel_create(unsigned int horizon);
+
+
+/***********************************************************************
+ * timer_wheel_destroy()
+ *
+ * DESCRIPTION
+ *   Free @wheel. Pending timers are left untouched.
+ */
+void timer_wheel_destroy(struct timer_wheel *wheel);
+
+
+/***********************************************************************
+ * timer_wheel_add()
+ *
+ * DESCRIPTION
+ *   Arm @timer to expire at @expires. A timer in the past never fires.
+ */
+void timer_wheel_add(struct timer_wheel *wheel, struct timer *timer, unsigned int expires);
+
+
+/***********************************************************************
+ * timer_wheel_del()
+ *
+ * DESCRIPTION
+ *   Disarm @timer
+ */
+void timer_wheel_del(struct timer_wheel *wheel, struct timer *timer);
+
+
+/***********************************************************************
+ * timer_wheel_advance()
+ *
+ * DESCRIPTION
+ *   Move the clock of @wheel forward to @now, cascading the timers on the
+ *   way. The timers expiring before @now should have been fired already.
+ */
+void timer_wheel_advance(struct timer_wheel *wheel, unsigned int now);
+
+
+/***********************************************************************
+ * timer_wheel_first_due()
+ *
+ * RETURN
+ *   The earliest-added timer expiring at the current time of @wheel
+ *   NULL if no timer expires now
+ */
+struct timer *timer_wheel_first_due(struct timer_wheel *wheel);
+
+
+/***********************************************************************
+ * timer_wheel_next_expiry()
+ *
+ * RETURN
+ *   The earliest expiry time of the timers in @wheel
+ *   UINT_MAX if no timer is armed
+ */
+unsigned int timer_wheel_next_expiry(struct timer_wheel *wheel);
+
+#endif